@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+stopwatch_t::stopwatch_t()
+: start(std::chrono::steady_clock::now()) {
+}
+
+double stopwatch_t::seconds() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t bench_random_u32(uint64_t* state) {
+  // splitmix64
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return (uint32_t)((z ^ (z >> 31)) >> 32);
+}
+
+void bench_parallel_for(void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count) {
+  std::vector<std::thread> threads;
+  for (uint32_t job_index = 1; job_index < job_count; ++job_index) {
+    threads.emplace_back(job, context, job_index);
+  }
+  job(context, 0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+uint64_t bench_env_u64(const char* name, uint64_t default_value) {
+  const char* value = getenv(name);
+  return value == NULL ? default_value : strtoull(value, NULL, 10);
+}
+
+void bench_profile_print() {
+  printf("%-12s %10s", "per op", "calls");
+  for (int counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+    printf(" %13s", containers_profile_counter_name((containers_profile_counter_t)counter));
+  }
+  printf("\n");
+  for (int op = 0; op < CONTAINERS_PROFILE_OP_COUNT; ++op) {
+    containers_profile_stats_t stats;
+    containers_profile_read((containers_profile_op_t)op, &stats);
+    if (stats.calls == 0) {
+      continue;
+    }
+    printf("%-12s %10llu", containers_profile_op_name((containers_profile_op_t)op), (unsigned long long)stats.calls);
+    for (int counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+      if (containers_profile_counter_available((containers_profile_counter_t)counter)) {
+        printf(" %13.2f", (double)stats.counters[counter] / (double)stats.calls);
+      }
+      else {
+        printf(" %13s", "-");
+      }
+    }
+    printf("\n");
+  }
+}
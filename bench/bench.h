@@ -0,0 +1,32 @@
+#pragma once
+#include <containers.h>
+#include <chrono>
+
+// Measures elapsed wall-clock time from construction.
+struct stopwatch_t {
+  stopwatch_t();
+  double seconds() const;
+
+  std::chrono::steady_clock::time_point start;
+};
+
+// Deterministic pseudo random numbers so runs are comparable.
+uint32_t bench_random_u32(uint64_t* state);
+
+// A parallel_for for containers_lib_config_t that runs each job on its own thread.
+void bench_parallel_for(void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count);
+
+// Reads a size limit from the environment, falling back to *default_value*. Lets big machines run the larger sizes.
+uint64_t bench_env_u64(const char* name, uint64_t default_value);
+
+// Prints per-operation averages of the library's profiling counters (see containers_profile_start).
+void bench_profile_print();
+
+// The benchmarks. Each one prints its own results.
+void bench_hash();
+void bench_index();
+void bench_join();
+void bench_queue();
+void bench_search();
+void bench_segmented();
+void bench_sort();
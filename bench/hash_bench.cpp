@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <vector>
+#include "bench.h"
+
+// The table holds BENCH_HASH_COUNT keys. The default fills a 4M bucket table to ~83%, where probe sequences are long
+// enough for the filter to pay off; set it higher for multi-GB tables.
+static const uint64_t HASH_COUNT_DEFAULT = 3500000;
+static const uint32_t LOOKUP_COUNT = 1 << 22;
+static const uint32_t MISS_PERCENT = 90;
+static const uint32_t SMALL_TABLE_COUNT = 100000;
+static const uint32_t SMALL_TABLE_KEYS = 12;
+
+// runs every lookup once and returns nanoseconds per lookup
+template <typename lookup_t>
+static double run(const std::vector<uint32_t>& queries, lookup_t lookup) {
+  uint64_t sink = 0;
+  stopwatch_t stopwatch;
+  for (uint32_t query : queries) {
+    sink += lookup(query);
+  }
+  const double seconds = stopwatch.seconds();
+  // keep the results alive so the lookups are not optimized away
+  if (sink == 0xdeadbeef) {
+    printf(" ");
+  }
+  return seconds * 1e9 / (double)queries.size();
+}
+
+// many small tables, looked up in random order so most lookups start with a cache miss
+static void bench_hash_small() {
+  std::vector<hash_t> hashes(SMALL_TABLE_COUNT);
+  std::vector<hash_small_t> smalls(SMALL_TABLE_COUNT);
+  std::vector<hash_small_t> fingerprints(SMALL_TABLE_COUNT);
+  std::vector<uint32_t> keys((size_t)SMALL_TABLE_COUNT * SMALL_TABLE_KEYS);
+  uint64_t seed = 2;
+  for (uint32_t table = 0; table < SMALL_TABLE_COUNT; ++table) {
+    hashes[table] = {};
+    hash_small_init(&smalls[table], false);
+    hash_small_init(&fingerprints[table], true);
+    for (uint32_t value = 0; value < SMALL_TABLE_KEYS; ++value) {
+      const uint32_t key = bench_random_u32(&seed) | 1;
+      keys[(size_t)table * SMALL_TABLE_KEYS + value] = key;
+      hash_insert(&hashes[table], key, value, NULL);
+      hash_small_insert(&smalls[table], key, (uint16_t)value, NULL);
+      hash_small_insert(&fingerprints[table], key, (uint16_t)value, NULL);
+    }
+  }
+
+  // queries are (table, key) pairs packed as the key's position in *keys*
+  std::vector<uint32_t> queries(LOOKUP_COUNT);
+  for (uint32_t index = 0; index < LOOKUP_COUNT; ++index) {
+    queries[index] = bench_random_u32(&seed) % (SMALL_TABLE_COUNT * SMALL_TABLE_KEYS);
+  }
+
+  size_t small_bytes = 0;
+  size_t fingerprint_bytes = 0;
+  for (uint32_t table = 0; table < SMALL_TABLE_COUNT; ++table) {
+    small_bytes += hash_small_size_bytes(&smalls[table]);
+    fingerprint_bytes += hash_small_size_bytes(&fingerprints[table]);
+  }
+  const size_t hash_bytes = (size_t)SMALL_TABLE_COUNT * hash_capacity(&hashes[0]) * 2 * sizeof(uint32_t);
+
+  printf("\n%u tables of %u keys, all hits\n", SMALL_TABLE_COUNT, SMALL_TABLE_KEYS);
+  printf("%-24s %10s %10s\n", "ns/lookup", "lookup", "B/table");
+  printf("%-24s %10.2f %10zu\n", "hash", run(queries, [&](uint32_t query) { return hash_lookup(&hashes[query / SMALL_TABLE_KEYS], keys[query], 0); }), hash_bytes / SMALL_TABLE_COUNT);
+  printf("%-24s %10.2f %10zu\n", "hash_small", run(queries, [&](uint32_t query) { return hash_small_lookup(&smalls[query / SMALL_TABLE_KEYS], keys[query], 0); }), small_bytes / SMALL_TABLE_COUNT);
+  printf("%-24s %10.2f %10zu\n", "hash_small fingerprints", run(queries, [&](uint32_t query) { return hash_small_lookup(&fingerprints[query / SMALL_TABLE_KEYS], keys[query], 0); }), fingerprint_bytes / SMALL_TABLE_COUNT);
+
+  for (uint32_t table = 0; table < SMALL_TABLE_COUNT; ++table) {
+    hash_free(&hashes[table], NULL);
+    hash_small_free(&smalls[table], NULL);
+    hash_small_free(&fingerprints[table], NULL);
+  }
+}
+
+void bench_hash() {
+  const uint32_t count = (uint32_t)bench_env_u64("BENCH_HASH_COUNT", HASH_COUNT_DEFAULT);
+
+  // present keys are odd, absent keys are even
+  hash_t hash = {};
+  uint64_t seed = 1;
+  std::vector<uint32_t> keys(count);
+  for (uint32_t index = 0; index < count; ++index) {
+    keys[index] = bench_random_u32(&seed) | 1;
+    hash_insert(&hash, keys[index], index, NULL);
+  }
+  std::vector<uint32_t> queries(LOOKUP_COUNT);
+  for (uint32_t index = 0; index < LOOKUP_COUNT; ++index) {
+    const bool miss = (bench_random_u32(&seed) % 100) < MISS_PERCENT;
+    queries[index] = miss ? (bench_random_u32(&seed) & ~1u) | 2 : keys[bench_random_u32(&seed) % count];
+  }
+
+  printf("%u keys, %u buckets, %u%% misses\n", count, hash_capacity(&hash), MISS_PERCENT);
+  const double hash_mb = (double)hash_capacity(&hash) * 2 * sizeof(uint32_t) / (1024.0 * 1024.0);
+  printf("%-24s %10s %10s\n", "ns/lookup", "lookup", "MB");
+  printf("%-24s %10.2f %10.1f\n", "hash", run(queries, [&hash](uint32_t key) { return hash_lookup(&hash, key, 0); }), hash_mb);
+
+  hash_frozen_t frozen;
+  stopwatch_t freeze_stopwatch;
+  hash_freeze(&hash, &frozen, NULL);
+  const double freeze_seconds = freeze_stopwatch.seconds();
+  const double frozen_mb = (double)hash_frozen_size_bytes(&frozen) / (1024.0 * 1024.0);
+  printf("%-24s %10.2f %10.1f  (built in %.0fms)\n", "hash_frozen", run(queries, [&frozen](uint32_t key) { return hash_frozen_lookup(&frozen, key, 0); }), frozen_mb, freeze_seconds * 1000.0);
+  hash_frozen_free(&frozen, NULL);
+
+  for (uint32_t bits_per_key = 8; bits_per_key <= 16; bits_per_key += 4) {
+    hash_filter_enable(&hash, bits_per_key, NULL);
+    char label[32];
+    snprintf(label, sizeof(label), "hash+filter(%u bits)", bits_per_key);
+    const double filter_mb = (double)hash.filter_block_count * 32 / (1024.0 * 1024.0);
+    printf("%-24s %10.2f %10.1f\n", label, run(queries, [&hash](uint32_t key) { return hash_lookup(&hash, key, 0); }), hash_mb + filter_mb);
+  }
+
+  hash_free(&hash, NULL);
+  bench_hash_small();
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "bench.h"
+
+// Sizes run from 1K up to BENCH_INDEX_MAX keys (default 64M, 256MB of keys, past the last level cache of most cpus).
+static const uint64_t INDEX_MIN = 1 << 10;
+static const uint64_t INDEX_MAX_DEFAULT = 1 << 26;
+static const uint32_t QUERY_COUNT = 1 << 22;
+
+// runs every query once and returns nanoseconds per query
+template <typename search_t>
+static double run(const std::vector<uint32_t>& queries, search_t search) {
+  uint64_t sink = 0;
+  stopwatch_t stopwatch;
+  for (uint32_t query : queries) {
+    sink += search(query);
+  }
+  const double seconds = stopwatch.seconds();
+  // keep the results alive so the searches are not optimized away
+  if (sink == 0xdeadbeef) {
+    printf(" ");
+  }
+  return seconds * 1e9 / (double)queries.size();
+}
+
+void bench_index() {
+  const uint64_t count_max = bench_env_u64("BENCH_INDEX_MAX", INDEX_MAX_DEFAULT);
+  uint64_t seed = 1;
+  std::vector<uint32_t> queries(QUERY_COUNT);
+  for (uint32_t& query : queries) {
+    query = bench_random_u32(&seed);
+  }
+
+  printf("%-12s %14s %14s\n", "ns/query", "lower_bound", "sorted_index");
+  for (uint64_t count = INDEX_MIN; count <= count_max; count *= 4) {
+    uint32_t* arr = NULL;
+    array_reserve(arr, (uint32_t)count, NULL);
+    for (uint64_t key = 0; key < count; ++key) {
+      array_push(arr, bench_random_u32(&seed), NULL);
+    }
+    array_sort_u32(arr, NULL);
+
+    sorted_index_t index;
+    sorted_index_init(&index, arr, NULL);
+    const double binary = run(queries, [arr, count](uint32_t value) { return (uint32_t)(std::lower_bound(arr, arr + count, value) - arr); });
+    const double tree = run(queries, [&index](uint32_t value) { return sorted_index_lower_bound(&index, value); });
+    printf("%-12llu %14.2f %14.2f\n", (unsigned long long)count, binary, tree);
+
+    sorted_index_free(&index, NULL);
+    array_free(arr, NULL);
+  }
+}
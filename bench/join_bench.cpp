@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <thread>
+#include "bench.h"
+
+// Build sides run from 1M up to BENCH_JOIN_MAX keys (default 16M); the probe side is twice the build side and half of
+// the probes hit.
+static const uint64_t JOIN_MIN = 1 << 20;
+static const uint64_t JOIN_MAX_DEFAULT = 1 << 24;
+
+// the baseline: a hash_t over the build keys and a hash_lookup per probe key
+static uint32_t naive_join(const uint32_t* build_keys, const uint32_t* probe_keys, uint32_t** build_indices, uint32_t** probe_indices) {
+  hash_t hash = {};
+  hash_reserve(&hash, array_count(build_keys), NULL);
+  for (uint32_t index = 0; index < array_count(build_keys); ++index) {
+    hash_insert(&hash, build_keys[index], index, NULL);
+  }
+  uint32_t matches = 0;
+  for (uint32_t index = 0; index < array_count(probe_keys); ++index) {
+    const uint32_t build_index = hash_lookup(&hash, probe_keys[index], ARRAY_INDEX_NONE);
+    if (build_index != ARRAY_INDEX_NONE) {
+      array_push(*build_indices, build_index, NULL);
+      array_push(*probe_indices, index, NULL);
+      ++matches;
+    }
+  }
+  hash_free(&hash, NULL);
+  return matches;
+}
+
+// runs *join* into empty outputs and returns milliseconds
+template <typename join_t>
+static double run(const uint32_t* build_keys, const uint32_t* probe_keys, uint32_t* matches, join_t join) {
+  uint32_t* build_indices = NULL;
+  uint32_t* probe_indices = NULL;
+  stopwatch_t stopwatch;
+  *matches = join(build_keys, probe_keys, &build_indices, &probe_indices);
+  const double seconds = stopwatch.seconds();
+  array_free(build_indices, NULL);
+  array_free(probe_indices, NULL);
+  return seconds * 1000.0;
+}
+
+void bench_join() {
+  const uint64_t count_max = bench_env_u64("BENCH_JOIN_MAX", JOIN_MAX_DEFAULT);
+  const uint32_t hardware_threads = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 1;
+  printf("%-12s %10s %10s %10s %10s\n", "build keys", "naive ms", "join ms", "join_mt ms", "matches");
+
+  for (uint64_t count = JOIN_MIN; count <= count_max; count *= 4) {
+    // distinct, nonzero build keys (multiplying by an odd constant is a bijection) so hash_t can hold them
+    uint32_t* build_keys = NULL;
+    uint32_t* probe_keys = NULL;
+    uint64_t seed = count;
+    for (uint32_t index = 0; index < count; ++index) {
+      array_push(build_keys, (index + 1) * 2654435761u, NULL);
+    }
+    for (uint32_t index = 0; index < count * 2; ++index) {
+      const uint32_t random = bench_random_u32(&seed);
+      array_push(probe_keys, (random & 1) ? build_keys[random % count] : bench_random_u32(&seed), NULL);
+    }
+
+    uint32_t matches_naive;
+    uint32_t matches_join;
+    uint32_t matches_join_mt;
+    const double time_naive = run(build_keys, probe_keys, &matches_naive, &naive_join);
+    const double time_join = run(build_keys, probe_keys, &matches_join, [](const uint32_t* build, const uint32_t* probe, uint32_t** build_indices, uint32_t** probe_indices) {
+      return hash_join_u32(build, probe, build_indices, probe_indices, NULL);
+    });
+
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    config.parallel_for = &bench_parallel_for;
+    config.job_count = hardware_threads;
+    containers_lib_init(&config);
+    const double time_join_mt = run(build_keys, probe_keys, &matches_join_mt, [](const uint32_t* build, const uint32_t* probe, uint32_t** build_indices, uint32_t** probe_indices) {
+      return hash_join_u32(build, probe, build_indices, probe_indices, NULL);
+    });
+    containers_lib_init(NULL);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%llu", (unsigned long long)count);
+    printf("%-12s %10.1f %10.1f %10.1f %10u%s\n", label, time_naive, time_join, time_join_mt, matches_join, (matches_naive == matches_join && matches_join == matches_join_mt) ? "" : " (mismatch)");
+
+    array_free(build_keys, NULL);
+    array_free(probe_keys, NULL);
+  }
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+struct bench_t {
+  const char* name;
+  void (*run)();
+};
+
+static const bench_t s_benches[] = {
+  {"hash", &bench_hash},
+  {"index", &bench_index},
+  {"join", &bench_join},
+  {"queue", &bench_queue},
+  {"search", &bench_search},
+  {"segmented", &bench_segmented},
+  {"sort", &bench_sort},
+};
+
+// Usage: bench_runner [--profile] [name...]
+// Runs every benchmark when no names are given. --profile prints hardware counter averages for the library's hot paths
+// after each benchmark; it needs a library built with CONTAINERS_PROFILE.
+int main(int argc, char** argv) {
+  containers_lib_init(NULL);
+  bool profile = false;
+  int name_count = 0;
+  for (int arg = 1; arg < argc; ++arg) {
+    if (strcmp(argv[arg], "--profile") == 0) {
+      profile = true;
+    }
+    else {
+      ++name_count;
+    }
+  }
+  for (const bench_t& bench : s_benches) {
+    bool selected = (name_count == 0);
+    for (int arg = 1; arg < argc; ++arg) {
+      selected = selected || (strcmp(argv[arg], bench.name) == 0);
+    }
+    if (!selected) {
+      continue;
+    }
+    printf("== %s\n", bench.name);
+    if (profile && !containers_profile_start()) {
+      printf("(no hardware counters available; only calls are counted)\n");
+    }
+    bench.run();
+    if (profile) {
+      containers_profile_stop();
+      bench_profile_print();
+    }
+  }
+  containers_lib_shutdown();
+  return 0;
+}
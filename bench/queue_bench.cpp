@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+static const uint32_t ITEM_COUNT = 1 << 22;
+static const uint32_t QUEUE_CAPACITY = 1024;
+static const uint32_t BATCH_SIZE = 32;
+
+// the baseline: an array guarded by a mutex
+struct locked_queue_t {
+  std::mutex mutex;
+  uint32_t* items = NULL;
+  uint32_t head = 0;
+};
+
+static bool locked_push(locked_queue_t* queue, uint32_t item) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (array_count(queue->items) - queue->head >= QUEUE_CAPACITY) {
+    return false;
+  }
+  array_push(queue->items, item, NULL);
+  return true;
+}
+
+static bool locked_pop(locked_queue_t* queue, uint32_t* item) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if (queue->head == array_count(queue->items)) {
+    return false;
+  }
+  *item = queue->items[queue->head++];
+  if (queue->head == array_count(queue->items)) {
+    queue->head = 0;
+    array_set_empty(queue->items);
+  }
+  return true;
+}
+
+// runs *producers* + *consumers* threads moving ITEM_COUNT items in total and returns millions of items per second
+template <typename push_t, typename pop_t>
+static double run(uint32_t producers, uint32_t consumers, push_t push, pop_t pop) {
+  std::vector<std::thread> threads;
+  stopwatch_t stopwatch;
+  for (uint32_t index = 0; index < producers; ++index) {
+    const uint32_t count = ITEM_COUNT / producers;
+    threads.emplace_back([count, &push]() {
+      for (uint32_t sent = 0; sent < count;) {
+        const uint32_t pushed = push(count - sent);
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+        sent += pushed;
+      }
+    });
+  }
+  for (uint32_t index = 0; index < consumers; ++index) {
+    const uint32_t count = (ITEM_COUNT / producers) * producers / consumers;
+    threads.emplace_back([count, &pop]() {
+      for (uint32_t received = 0; received < count;) {
+        const uint32_t popped = pop(count - received);
+        if (popped == 0) {
+          std::this_thread::yield();
+        }
+        received += popped;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return ITEM_COUNT / stopwatch.seconds() / 1e6;
+}
+
+void bench_queue() {
+  printf("%-12s %9s %9s %12s\n", "queue", "producers", "consumers", "Mitems/s");
+
+  {
+    spsc_queue_t queue;
+    spsc_queue_init(&queue, QUEUE_CAPACITY, sizeof(uint32_t), NULL);
+    auto push = [&queue](uint32_t) {
+      uint32_t item = 1;
+      return spsc_queue_push(&queue, &item) ? 1u : 0u;
+    };
+    auto pop = [&queue](uint32_t) {
+      uint32_t item;
+      return spsc_queue_pop(&queue, &item) ? 1u : 0u;
+    };
+    auto push_n = [&queue](uint32_t left) {
+      uint32_t items[BATCH_SIZE] = {};
+      return spsc_queue_push_n(&queue, items, left < BATCH_SIZE ? left : BATCH_SIZE);
+    };
+    auto pop_n = [&queue](uint32_t left) {
+      uint32_t items[BATCH_SIZE];
+      return spsc_queue_pop_n(&queue, items, left < BATCH_SIZE ? left : BATCH_SIZE);
+    };
+    printf("%-12s %9u %9u %12.2f\n", "spsc", 1, 1, run(1, 1, push, pop));
+    printf("%-12s %9u %9u %12.2f\n", "spsc_n", 1, 1, run(1, 1, push_n, pop_n));
+    spsc_queue_free(&queue, NULL);
+  }
+
+  const uint32_t hardware_threads = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 2;
+  for (uint32_t threads = 1; threads * 2 <= hardware_threads; threads *= 2) {
+    mpmc_queue_t queue;
+    mpmc_queue_init(&queue, QUEUE_CAPACITY, sizeof(uint32_t), NULL);
+    auto push = [&queue](uint32_t) {
+      uint32_t item = 1;
+      return mpmc_queue_push(&queue, &item) ? 1u : 0u;
+    };
+    auto pop = [&queue](uint32_t) {
+      uint32_t item;
+      return mpmc_queue_pop(&queue, &item) ? 1u : 0u;
+    };
+    auto push_n = [&queue](uint32_t left) {
+      uint32_t items[BATCH_SIZE] = {};
+      return mpmc_queue_push_n(&queue, items, left < BATCH_SIZE ? left : BATCH_SIZE);
+    };
+    auto pop_n = [&queue](uint32_t left) {
+      uint32_t items[BATCH_SIZE];
+      return mpmc_queue_pop_n(&queue, items, left < BATCH_SIZE ? left : BATCH_SIZE);
+    };
+    printf("%-12s %9u %9u %12.2f\n", "mpmc", threads, threads, run(threads, threads, push, pop));
+    printf("%-12s %9u %9u %12.2f\n", "mpmc_n", threads, threads, run(threads, threads, push_n, pop_n));
+    mpmc_queue_free(&queue, NULL);
+
+    locked_queue_t locked;
+    auto locked_push_one = [&locked](uint32_t) {
+      return locked_push(&locked, 1) ? 1u : 0u;
+    };
+    auto locked_pop_one = [&locked](uint32_t) {
+      uint32_t item;
+      return locked_pop(&locked, &item) ? 1u : 0u;
+    };
+    printf("%-12s %9u %9u %12.2f\n", "mutex+array", threads, threads, run(threads, threads, locked_push_one, locked_pop_one));
+    array_free(locked.items, NULL);
+  }
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <chrono>
+#include "bench.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BENCH_HAS_RDTSC 1
+#endif
+
+// Array sizes chosen to sit in L1, L2 and DRAM respectively.
+static const uint32_t SEARCH_COUNTS[] = {4 << 10, 64 << 10, 16 << 20};
+static const uint64_t SEARCH_BYTES_PER_RUN = 1ull << 30;
+
+static const char* const SIMD_NAMES[] = {"scalar", "sse2", "avx2", "avx512"};
+
+// Reads the time stamp counter. It ticks at a fixed reference rate, which may differ from the core clock under turbo.
+static uint64_t cycles_now() {
+#ifdef BENCH_HAS_RDTSC
+  return __rdtsc();
+#else
+  return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// runs *search* repeatedly over *bytes*-sized input and returns bytes per cycle
+template <typename search_t>
+static double run(uint64_t bytes, search_t search) {
+  const uint64_t repeats = SEARCH_BYTES_PER_RUN / bytes;
+  uint64_t sink = 0;
+  const uint64_t start = cycles_now();
+  for (uint64_t repeat = 0; repeat < repeats; ++repeat) {
+    sink += search();
+  }
+  const uint64_t cycles = cycles_now() - start;
+  // keep the results alive so the searches are not optimized away
+  if (sink == 0xdeadbeef) {
+    printf(" ");
+  }
+  return (double)(bytes * repeats) / (double)cycles;
+}
+
+void bench_search() {
+#ifndef BENCH_HAS_RDTSC
+  printf("(no rdtsc on this platform; the cycle column is steady_clock ticks)\n");
+#endif
+  printf("%-8s %10s %8s %8s %8s %8s %8s %8s\n", "bytes/cy", "count", "find_u32", "cnt_u32", "min_u32", "find_u64", "find_f32", "min_f32");
+
+  for (uint32_t count : SEARCH_COUNTS) {
+    uint32_t* arr_u32 = NULL;
+    uint64_t* arr_u64 = NULL;
+    float* arr_f32 = NULL;
+    uint64_t seed = count;
+    for (uint32_t index = 0; index < count; ++index) {
+      const uint32_t value = bench_random_u32(&seed) | 1;
+      array_push(arr_u32, value, NULL);
+      array_push(arr_u64, value, NULL);
+      array_push(arr_f32, (float)value, NULL);
+    }
+
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    for (int level = CONTAINERS_SIMD_SCALAR; level <= CONTAINERS_SIMD_AVX512; ++level) {
+      config.simd_level = (containers_simd_t)level;
+      containers_lib_init(&config);
+      if (containers_lib_simd_level() != level) {
+        continue;
+      }
+      // searching for an absent value scans the whole array
+      const double find_u32 = run(count * sizeof(uint32_t), [arr_u32]() { return array_find_first_u32(arr_u32, 0); });
+      const double count_u32 = run(count * sizeof(uint32_t), [arr_u32]() { return array_count_equal_u32(arr_u32, 0); });
+      const double min_u32 = run(count * sizeof(uint32_t), [arr_u32]() { return array_min_index_u32(arr_u32); });
+      const double find_u64 = run(count * sizeof(uint64_t), [arr_u64]() { return array_find_first_u64(arr_u64, 0); });
+      const double find_f32 = run(count * sizeof(float), [arr_f32]() { return array_find_first_f32(arr_f32, 0.0f); });
+      const double min_f32 = run(count * sizeof(float), [arr_f32]() { return array_min_index_f32(arr_f32); });
+      printf("%-8s %10u %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", SIMD_NAMES[level], count, find_u32, count_u32, min_u32, find_u64, find_f32, min_f32);
+    }
+    containers_lib_init(NULL);
+
+    array_free(arr_u32, NULL);
+    array_free(arr_u64, NULL);
+    array_free(arr_f32, NULL);
+  }
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+static const uint32_t ITEM_COUNT = 1 << 23;
+static const uint32_t BATCH_SIZE = 32;
+
+// runs *threads* threads appending ITEM_COUNT items in total and returns millions of items per second
+template <typename push_t>
+static double run(uint32_t threads, push_t push) {
+  std::vector<std::thread> workers;
+  stopwatch_t stopwatch;
+  for (uint32_t index = 0; index < threads; ++index) {
+    const uint32_t count = ITEM_COUNT / threads;
+    workers.emplace_back([index, count, &push]() {
+      for (uint32_t sent = 0; sent < count;) {
+        sent += push(index, count - sent);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return ITEM_COUNT / stopwatch.seconds() / 1e6;
+}
+
+void bench_segmented() {
+  printf("%-16s %8s %12s\n", "append", "threads", "Mitems/s");
+
+  const uint32_t hardware_threads = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 1;
+  const uint32_t max_threads = (uint32_t)bench_env_u64("BENCH_SEGMENTED_MAX_THREADS", hardware_threads < 4 ? 4 : hardware_threads);
+  for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+    {
+      segmented_array_t arr;
+      segmented_array_init(&arr, sizeof(uint32_t));
+      auto push = [&arr](uint32_t value, uint32_t) {
+        segmented_array_push(&arr, &value, NULL);
+        return 1u;
+      };
+      printf("%-16s %8u %12.2f\n", "segmented", threads, run(threads, push));
+      segmented_array_free(&arr, NULL);
+    }
+
+    {
+      segmented_array_t arr;
+      segmented_array_init(&arr, sizeof(uint32_t));
+      auto push_n = [&arr](uint32_t value, uint32_t left) {
+        uint32_t items[BATCH_SIZE] = {value};
+        const uint32_t count = left < BATCH_SIZE ? left : BATCH_SIZE;
+        segmented_array_push_n(&arr, items, count, NULL);
+        return count;
+      };
+      printf("%-16s %8u %12.2f\n", "segmented_n", threads, run(threads, push_n));
+      segmented_array_free(&arr, NULL);
+    }
+
+    // the baseline: a stretchy buffer guarded by a mutex
+    {
+      std::mutex mutex;
+      uint32_t* arr = NULL;
+      auto push = [&mutex, &arr](uint32_t value, uint32_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        array_push(arr, value, NULL);
+        return 1u;
+      };
+      printf("%-16s %8u %12.2f\n", "mutex+array", threads, run(threads, push));
+      array_free(arr, NULL);
+    }
+  }
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+// Sizes run in powers of 10 from 1K up to BENCH_SORT_MAX elements (default 10M). Going to 1B needs roughly 40GB of
+// memory for the u32 columns. Stretchy buffers count their bytes in 32 bits, so the u64 columns stop below 2^29
+// elements and print "-" from there on.
+static const uint64_t SORT_MIN = 1000;
+static const uint64_t SORT_MAX_DEFAULT = 10000000;
+static const uint64_t SORT_U64_MAX = (1u << 29) - 1;
+
+template <typename key_t>
+struct pair_t {
+  key_t key;
+  uint32_t value;
+};
+
+static int compare_u32(const void* a, const void* b) {
+  const uint32_t lhs = *(const uint32_t*)a;
+  const uint32_t rhs = *(const uint32_t*)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+// runs *sort* over a fresh copy of *input* enough times to be measurable and returns nanoseconds per element
+template <typename key_t, typename sort_t>
+static double run(const key_t* input, uint32_t count, key_t* scratch, sort_t sort) {
+  const uint32_t repeats = count < (1 << 22) ? (1 << 22) / count : 1;
+  double seconds = 0.0;
+  for (uint32_t repeat = 0; repeat < repeats; ++repeat) {
+    memcpy(scratch, input, (size_t)count * sizeof(key_t));
+    stopwatch_t stopwatch;
+    sort(scratch, count);
+    seconds += stopwatch.seconds();
+  }
+  return seconds * 1e9 / ((double)count * repeats);
+}
+
+// prints a column of nanoseconds per element, or "-" for one that was not run (negative)
+static void print_time(double time, int width) {
+  if (time < 0.0) {
+    printf(" %*s", width, "-");
+  }
+  else {
+    printf(" %*.2f", width, time);
+  }
+}
+
+// sorts (key, index) pairs with std::stable_sort, the way callers pair keys with a payload today
+template <typename key_t>
+static void std_sort_pairs(std::vector<pair_t<key_t>>& pairs, const key_t* keys, uint32_t count) {
+  for (uint32_t index = 0; index < count; ++index) {
+    pairs[index].key = keys[index];
+    pairs[index].value = index;
+  }
+  std::stable_sort(pairs.begin(), pairs.end(), [](const pair_t<key_t>& lhs, const pair_t<key_t>& rhs) { return lhs.key < rhs.key; });
+}
+
+void bench_sort() {
+  const uint64_t count_max = bench_env_u64("BENCH_SORT_MAX", SORT_MAX_DEFAULT);
+  const uint32_t hardware_threads = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 1;
+  printf("%-12s %8s %8s %8s %8s %8s %10s %11s %8s %8s %10s %8s %10s %13s\n", "ns/element", "qsort", "std", "radix", "radix_mt", "std_kv", "radix_kv", "radix_kv_mt", "std64", "radix64", "radix64_mt", "std_kv64", "radix_kv64", "radix_kv64_mt");
+
+  for (uint64_t count = SORT_MIN; count <= count_max && count <= 0xffffffffu; count *= 10) {
+    uint32_t* input = NULL;
+    uint32_t* keys = NULL;
+    uint64_t* input64 = NULL;
+    uint64_t* keys64 = NULL;
+    uint32_t* values = NULL;
+    const bool run64 = count <= SORT_U64_MAX;
+    array_reserve(input, (uint32_t)count, NULL);
+    array_reserve(values, (uint32_t)count, NULL);
+    if (run64) {
+      array_reserve(input64, (uint32_t)count, NULL);
+    }
+    uint64_t seed = count;
+    for (uint32_t index = 0; index < count; ++index) {
+      const uint64_t high = bench_random_u32(&seed);
+      const uint32_t low = bench_random_u32(&seed);
+      array_push(input, low, NULL);
+      if (run64) {
+        array_push(input64, (high << 32) | low, NULL);
+      }
+    }
+    array_push_n(keys, input, (uint32_t)count, NULL);
+    if (run64) {
+      array_push_n(keys64, input64, (uint32_t)count, NULL);
+    }
+    std::vector<pair_t<uint32_t>> pairs(count);
+    std::vector<pair_t<uint64_t>> pairs64(run64 ? count : 0);
+
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    containers_lib_init(&config);
+
+    const double time_qsort = run(input, (uint32_t)count, keys, [](uint32_t* arr, uint32_t n) {
+      qsort(arr, n, sizeof(uint32_t), &compare_u32);
+    });
+    const double time_std = run(input, (uint32_t)count, keys, [](uint32_t* arr, uint32_t n) {
+      std::sort(arr, arr + n);
+    });
+    const double time_radix = run(input, (uint32_t)count, keys, [](uint32_t* arr, uint32_t) {
+      array_sort_u32(arr, NULL);
+    });
+    const double time_std_kv = run(input, (uint32_t)count, keys, [&pairs](uint32_t* arr, uint32_t n) {
+      std_sort_pairs(pairs, arr, n);
+    });
+    auto sort_pairs = [values](uint32_t* arr, uint32_t n) {
+      for (uint32_t index = 0; index < n; ++index) {
+        values[index] = index;
+      }
+      array_sort_pairs_u32(arr, values, NULL);
+    };
+    const double time_radix_kv = run(input, (uint32_t)count, keys, sort_pairs);
+
+    auto sort64 = [](uint64_t* arr, uint32_t) {
+      array_sort_u64(arr, NULL);
+    };
+    auto sort_pairs64 = [values](uint64_t* arr, uint32_t n) {
+      for (uint32_t index = 0; index < n; ++index) {
+        values[index] = index;
+      }
+      array_sort_pairs_u64(arr, values, NULL);
+    };
+    double time_std64 = -1.0;
+    double time_radix64 = -1.0;
+    double time_std_kv64 = -1.0;
+    double time_radix_kv64 = -1.0;
+    if (run64) {
+      time_std64 = run(input64, (uint32_t)count, keys64, [](uint64_t* arr, uint32_t n) {
+        std::sort(arr, arr + n);
+      });
+      time_radix64 = run(input64, (uint32_t)count, keys64, sort64);
+      time_std_kv64 = run(input64, (uint32_t)count, keys64, [&pairs64](uint64_t* arr, uint32_t n) {
+        std_sort_pairs(pairs64, arr, n);
+      });
+      time_radix_kv64 = run(input64, (uint32_t)count, keys64, sort_pairs64);
+    }
+
+    config.parallel_for = &bench_parallel_for;
+    config.job_count = hardware_threads;
+    containers_lib_init(&config);
+    const double time_radix_mt = run(input, (uint32_t)count, keys, [](uint32_t* arr, uint32_t) {
+      array_sort_u32(arr, NULL);
+    });
+    const double time_radix_kv_mt = run(input, (uint32_t)count, keys, sort_pairs);
+    const double time_radix64_mt = run64 ? run(input64, (uint32_t)count, keys64, sort64) : -1.0;
+    const double time_radix_kv64_mt = run64 ? run(input64, (uint32_t)count, keys64, sort_pairs64) : -1.0;
+    containers_lib_init(NULL);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%llu", (unsigned long long)count);
+    printf("%-12s %8.2f %8.2f %8.2f %8.2f %8.2f %10.2f %11.2f", label, time_qsort, time_std, time_radix, time_radix_mt, time_std_kv, time_radix_kv, time_radix_kv_mt);
+    print_time(time_std64, 8);
+    print_time(time_radix64, 8);
+    print_time(time_radix64_mt, 10);
+    print_time(time_std_kv64, 8);
+    print_time(time_radix_kv64, 10);
+    print_time(time_radix_kv64_mt, 13);
+    printf("\n");
+
+    array_free(input, NULL);
+    array_free(keys, NULL);
+    array_free(input64, NULL);
+    array_free(keys64, NULL);
+    array_free(values, NULL);
+  }
+}
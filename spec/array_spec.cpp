@@ -1,3 +1,7 @@
+#include <math.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include "utils.h"
 
 TEST_CASE("array") {
@@ -291,6 +295,359 @@ TEST_CASE("array") {
   }
 }
 
+TEST_CASE("array sort") {
+  init_t init(NULL);
+  uint64_t seed = 1;
+  auto random_u64 = [&seed]() {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed;
+  };
+
+  SECTION("array_sort_u32 handles NULL and single elements") {
+    uint32_t* arr = NULL;
+    array_sort_u32(arr, NULL);
+    CHECK(arr == NULL);
+    array_push(arr, 42, NULL);
+    array_sort_u32(arr, NULL);
+    CHECK(arr[0] == 42);
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_sort_u32 matches std::sort") {
+    uint32_t* arr = NULL;
+    for (uint32_t index = 0; index < 10000; ++index) {
+      array_push(arr, (uint32_t)(random_u64() >> 32), NULL);
+    }
+    std::vector<uint32_t> expected(arr, arr + array_count(arr));
+    std::sort(expected.begin(), expected.end());
+    array_sort_u32(arr, NULL);
+    CHECK(std::equal(expected.begin(), expected.end(), arr));
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_sort_u32 handles keys that only differ in some digits") {
+    uint32_t* arr = NULL;
+    uint32_t items[] = {0x00030000, 0x00010000, 0x00020000, 0x00010000};
+    array_push_n(arr, items, 4, NULL);
+    array_sort_u32(arr, NULL);
+    CHECK(arr[0] == 0x00010000);
+    CHECK(arr[1] == 0x00010000);
+    CHECK(arr[2] == 0x00020000);
+    CHECK(arr[3] == 0x00030000);
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_sort_u64 matches std::sort") {
+    uint64_t* arr = NULL;
+    for (uint32_t index = 0; index < 10000; ++index) {
+      array_push(arr, random_u64(), NULL);
+    }
+    std::vector<uint64_t> expected(arr, arr + array_count(arr));
+    std::sort(expected.begin(), expected.end());
+    array_sort_u64(arr, NULL);
+    CHECK(std::equal(expected.begin(), expected.end(), arr));
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_sort_pairs_u32 carries the values and is stable") {
+    uint32_t* keys = NULL;
+    uint32_t* values = NULL;
+    for (uint32_t index = 0; index < 10000; ++index) {
+      array_push(keys, (uint32_t)(random_u64() >> 32) % 100, NULL);
+      array_push(values, index, NULL);
+    }
+    std::vector<uint32_t> original(keys, keys + array_count(keys));
+    array_sort_pairs_u32(keys, values, NULL);
+    bool ok = true;
+    for (uint32_t index = 0; index < array_count(keys); ++index) {
+      ok = ok && (original[values[index]] == keys[index]);
+      if (index > 0) {
+        ok = ok && (keys[index - 1] < keys[index] || (keys[index - 1] == keys[index] && values[index - 1] < values[index]));
+      }
+    }
+    CHECK(ok);
+    array_free(keys, NULL);
+    array_free(values, NULL);
+  }
+
+  SECTION("array_sort_pairs_u64 carries the values") {
+    uint64_t* keys = NULL;
+    uint32_t* values = NULL;
+    for (uint32_t index = 0; index < 10000; ++index) {
+      array_push(keys, random_u64(), NULL);
+      array_push(values, index, NULL);
+    }
+    std::vector<uint64_t> original(keys, keys + array_count(keys));
+    array_sort_pairs_u64(keys, values, NULL);
+    bool ok = true;
+    for (uint32_t index = 0; index < array_count(keys); ++index) {
+      ok = ok && (original[values[index]] == keys[index]);
+      ok = ok && (index == 0 || keys[index - 1] <= keys[index]);
+    }
+    CHECK(ok);
+    array_free(keys, NULL);
+    array_free(values, NULL);
+  }
+}
+
+TEST_CASE("array sort with parallel_for") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.parallel_for = [](void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count) {
+    std::vector<std::thread> threads;
+    for (uint32_t job_index = 0; job_index < job_count; ++job_index) {
+      threads.emplace_back(job, context, job_index);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  config.job_count = 4;
+  init_t init(&config);
+
+  SECTION("array_sort_pairs_u32 splits large arrays into jobs and stays stable") {
+    uint32_t* keys = NULL;
+    uint32_t* values = NULL;
+    uint64_t seed = 1;
+    for (uint32_t index = 0; index < 200000; ++index) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      array_push(keys, (uint32_t)(seed >> 32) % 5000, NULL);
+      array_push(values, index, NULL);
+    }
+    std::vector<uint32_t> original(keys, keys + array_count(keys));
+    array_sort_pairs_u32(keys, values, NULL);
+    bool ok = true;
+    for (uint32_t index = 0; index < array_count(keys); ++index) {
+      ok = ok && (original[values[index]] == keys[index]);
+      if (index > 0) {
+        ok = ok && (keys[index - 1] < keys[index] || (keys[index - 1] == keys[index] && values[index - 1] < values[index]));
+      }
+    }
+    CHECK(ok);
+    array_free(keys, NULL);
+    array_free(values, NULL);
+  }
+}
+
+TEST_CASE("array search") {
+  SECTION("the search functions handle NULL") {
+    for_each_simd_level([]() {
+      uint32_t* arr = NULL;
+      CHECK(array_find_first_u32(arr, 0) == ARRAY_INDEX_NONE);
+      CHECK(array_count_equal_u32(arr, 0) == 0);
+      CHECK(!array_contains_u32(arr, 0));
+      CHECK(array_min_index_u32(arr) == ARRAY_INDEX_NONE);
+      CHECK(array_max_index_u32(arr) == ARRAY_INDEX_NONE);
+    });
+  }
+
+  SECTION("array_find_first_u32 finds the first match at every position") {
+    for_each_simd_level([]() {
+      uint32_t* arr = NULL;
+      for (uint32_t index = 0; index < 300; ++index) {
+        array_push(arr, index | 0x80000000u, NULL);
+      }
+      bool ok = true;
+      for (uint32_t index = 0; index < 300; ++index) {
+        ok = ok && (array_find_first_u32(arr, index | 0x80000000u) == index);
+      }
+      CHECK(ok);
+      arr[200] = 0x80000005u;
+      CHECK(array_find_first_u32(arr, 0x80000005u) == 5);
+      CHECK(array_find_first_u32(arr, 7) == ARRAY_INDEX_NONE);
+      CHECK(array_contains_u32(arr, 0x80000000u + 299));
+      CHECK(!array_contains_u32(arr, 300));
+      array_free(arr, NULL);
+    });
+  }
+
+  SECTION("array_find_first_u64 only matches all 64 bits") {
+    for_each_simd_level([]() {
+      uint64_t* arr = NULL;
+      for (uint64_t index = 0; index < 100; ++index) {
+        array_push(arr, (index << 32) | 7, NULL);
+      }
+      CHECK(array_find_first_u64(arr, (63ull << 32) | 7) == 63);
+      CHECK(array_find_first_u64(arr, 7) == 0);
+      CHECK(array_find_first_u64(arr, (63ull << 32) | 8) == ARRAY_INDEX_NONE);
+      CHECK(array_find_first_u64(arr, 63) == ARRAY_INDEX_NONE);
+      CHECK(array_contains_u64(arr, (99ull << 32) | 7));
+      array_free(arr, NULL);
+    });
+  }
+
+  SECTION("array_find_first_f32 uses float equality") {
+    for_each_simd_level([]() {
+      float* arr = NULL;
+      for (uint32_t index = 0; index < 100; ++index) {
+        array_push(arr, (float)index + 0.5f, NULL);
+      }
+      arr[70] = -0.0f;
+      arr[80] = NAN;
+      CHECK(array_find_first_f32(arr, 42.5f) == 42);
+      CHECK(array_find_first_f32(arr, 0.0f) == 70);
+      CHECK(array_find_first_f32(arr, NAN) == ARRAY_INDEX_NONE);
+      CHECK(array_contains_f32(arr, 99.5f));
+      array_free(arr, NULL);
+    });
+  }
+
+  SECTION("array_count_equal counts every match") {
+    for_each_simd_level([]() {
+      uint32_t* arr_u32 = NULL;
+      uint64_t* arr_u64 = NULL;
+      float* arr_f32 = NULL;
+      for (uint32_t index = 0; index < 1000; ++index) {
+        array_push(arr_u32, index % 7, NULL);
+        array_push(arr_u64, ((uint64_t)(index % 7) << 40) | 1, NULL);
+        array_push(arr_f32, (float)(index % 7), NULL);
+      }
+      CHECK(array_count_equal_u32(arr_u32, 3) == 143);
+      CHECK(array_count_equal_u32(arr_u32, 6) == 142);
+      CHECK(array_count_equal_u32(arr_u32, 7) == 0);
+      CHECK(array_count_equal_u64(arr_u64, (3ull << 40) | 1) == 143);
+      CHECK(array_count_equal_u64(arr_u64, 3) == 0);
+      CHECK(array_count_equal_f32(arr_f32, 3.0f) == 143);
+      array_free(arr_u32, NULL);
+      array_free(arr_u64, NULL);
+      array_free(arr_f32, NULL);
+    });
+  }
+
+  SECTION("array_min_index and array_max_index find the first extreme") {
+    for_each_simd_level([]() {
+      uint32_t* arr_u32 = NULL;
+      uint64_t* arr_u64 = NULL;
+      float* arr_f32 = NULL;
+      for (uint32_t index = 0; index < 500; ++index) {
+        const uint32_t value = (index * 2654435761u) % 1000 + 10;
+        array_push(arr_u32, value | 0x80000000u, NULL);
+        array_push(arr_u64, ((uint64_t)value << 33) | 0x8000000000000000ull, NULL);
+        array_push(arr_f32, (float)value - 500.0f, NULL);
+      }
+      arr_u32[123] = arr_u32[321] = 0x80000001u;
+      arr_u32[222] = arr_u32[444] = 0xffffffffu;
+      arr_u64[123] = arr_u64[321] = 0x8000000000000001ull;
+      arr_u64[222] = arr_u64[444] = 0xffffffffffffffffull;
+      arr_f32[123] = arr_f32[321] = -1000.0f;
+      arr_f32[222] = arr_f32[444] = 1000.0f;
+      arr_f32[0] = NAN;
+      arr_f32[499] = NAN;
+      CHECK(array_min_index_u32(arr_u32) == 123);
+      CHECK(array_max_index_u32(arr_u32) == 222);
+      CHECK(array_min_index_u64(arr_u64) == 123);
+      CHECK(array_max_index_u64(arr_u64) == 222);
+      CHECK(array_min_index_f32(arr_f32) == 123);
+      CHECK(array_max_index_f32(arr_f32) == 222);
+      array_free(arr_u32, NULL);
+      array_free(arr_u64, NULL);
+      array_free(arr_f32, NULL);
+    });
+  }
+
+  SECTION("array_min_index_f32 gives none for only NaNs") {
+    for_each_simd_level([]() {
+      float* arr = NULL;
+      for (uint32_t index = 0; index < 40; ++index) {
+        array_push(arr, NAN, NULL);
+      }
+      CHECK(array_min_index_f32(arr) == ARRAY_INDEX_NONE);
+      CHECK(array_max_index_f32(arr) == ARRAY_INDEX_NONE);
+      arr[39] = INFINITY;
+      CHECK(array_min_index_f32(arr) == 39);
+      array_free(arr, NULL);
+    });
+  }
+}
+
+TEST_CASE("array bulk removal") {
+  init_t init(NULL);
+
+  SECTION("array_remove_if keeps the order of the remaining elements") {
+    int* arr = NULL;
+    for (int value = 0; value < 10; ++value) {
+      array_push(arr, value, NULL);
+    }
+    int divisor = 3;
+    array_remove_if(arr, [](const void* item, void* context) { return (*(const int*)item % *(int*)context) == 0; }, &divisor);
+    CHECK(array_count(arr) == 6);
+    CHECK(arr[0] == 1);
+    CHECK(arr[1] == 2);
+    CHECK(arr[2] == 4);
+    CHECK(arr[3] == 5);
+    CHECK(arr[4] == 7);
+    CHECK(arr[5] == 8);
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_remove_if handles NULL") {
+    int* arr = NULL;
+    array_remove_if(arr, [](const void*, void*) { return true; }, NULL);
+    CHECK(array_count(arr) == 0);
+  }
+
+  SECTION("array_remove_indices removes scattered and adjacent indices") {
+    int* arr = NULL;
+    for (int value = 0; value < 10; ++value) {
+      array_push(arr, value, NULL);
+    }
+    uint32_t indices[] = {0, 3, 4, 9};
+    array_remove_indices(arr, indices, 4);
+    CHECK(array_count(arr) == 6);
+    CHECK(arr[0] == 1);
+    CHECK(arr[1] == 2);
+    CHECK(arr[2] == 5);
+    CHECK(arr[3] == 6);
+    CHECK(arr[4] == 7);
+    CHECK(arr[5] == 8);
+    array_free(arr, NULL);
+  }
+
+  SECTION("array_remove_mask matches a reference filter for every element size") {
+    for_each_simd_level([]() {
+      const uint32_t count = 1000;
+      std::vector<uint64_t> mask((count + 63) / 64, 0);
+      uint64_t seed = 7;
+      for (uint32_t index = 0; index < count; ++index) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        // leave some whole words untouched to exercise the skip path
+        if ((index / 64) % 3 != 1 && (seed >> 60) < 5) {
+          mask[index / 64] |= 1ull << (index % 64);
+        }
+      }
+
+      uint16_t* arr_u16 = NULL;
+      uint32_t* arr_u32 = NULL;
+      uint64_t* arr_u64 = NULL;
+      std::vector<uint32_t> expected;
+      for (uint32_t index = 0; index < count; ++index) {
+        array_push(arr_u16, (uint16_t)index, NULL);
+        array_push(arr_u32, index, NULL);
+        array_push(arr_u64, (uint64_t)index << 32, NULL);
+        if ((mask[index / 64] & (1ull << (index % 64))) == 0) {
+          expected.push_back(index);
+        }
+      }
+      array_remove_mask(arr_u16, mask.data());
+      array_remove_mask(arr_u32, mask.data());
+      array_remove_mask(arr_u64, mask.data());
+      REQUIRE(array_count(arr_u16) == expected.size());
+      REQUIRE(array_count(arr_u32) == expected.size());
+      REQUIRE(array_count(arr_u64) == expected.size());
+      bool ok = true;
+      for (uint32_t index = 0; index < expected.size(); ++index) {
+        ok = ok && arr_u16[index] == (uint16_t)expected[index];
+        ok = ok && arr_u32[index] == expected[index];
+        ok = ok && arr_u64[index] == (uint64_t)expected[index] << 32;
+      }
+      CHECK(ok);
+      array_free(arr_u16, NULL);
+      array_free(arr_u32, NULL);
+      array_free(arr_u64, NULL);
+    });
+  }
+}
+
 TEST_CASE("array with custom alloc") {
   containers_lib_config_t config;
   containers_lib_config_init(&config);
@@ -362,6 +719,17 @@ TEST_CASE("array with checks") {
     array_free(arr, NULL);
   }
 
+  SECTION("array_remove_indices asserts if the indices are not ascending") {
+    int* arr = NULL;
+    int items[] = {0, 1, 2, 3};
+    array_push_n(arr, items, 4, NULL);
+    uint32_t indices[] = {2, 1};
+    CHECK_THROWS_WITH(array_remove_indices(arr, indices, 2), "indices must be ascending, unique and in range");
+    uint32_t out_of_range[] = {4};
+    CHECK_THROWS_WITH(array_remove_indices(arr, out_of_range, 1), "indices must be ascending, unique and in range");
+    array_free(arr, NULL);
+  }
+
   SECTION("array_shift_n asserts if the array is too small") {
     int* arr = NULL;
     CHECK_THROWS_WITH(array_shift_n(arr, 1), "array must contain at least 1 element");
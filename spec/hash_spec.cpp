@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <vector>
 #include "utils.h"
 
 TEST_CASE("hash") {
@@ -32,6 +34,27 @@ TEST_CASE("hash") {
     hash_free(&hash, NULL);
   }
 
+  SECTION("hash_remove removes the key and backshifts its neighbours") {
+    hash_t hash = {};
+    hash_insert(&hash, 1, 1, NULL);
+    hash_insert(&hash, 129, 129, NULL);
+    hash_insert(&hash, 257, 257, NULL);
+    hash_insert(&hash, 2, 2, NULL);
+    hash_remove(&hash, 1);
+    CHECK(!hash_contains(&hash, 1));
+    CHECK(hash_lookup(&hash, 129, 0) == 129);
+    CHECK(hash_lookup(&hash, 257, 0) == 257);
+    CHECK(hash_lookup(&hash, 2, 0) == 2);
+    CHECK(hash.keys[1] == 129);
+    CHECK(hash.keys[2] == 257);
+    CHECK(hash.keys[3] == 2);
+    CHECK(hash.keys[4] == 0);
+    hash_remove(&hash, 2);
+    CHECK(!hash_contains(&hash, 2));
+    CHECK(hash.keys[3] == 0);
+    hash_free(&hash, NULL);
+  }
+
   SECTION("hash_remove gracefully handles an empty table") {
     hash_t hash = {};
     hash_remove(&hash, 1234);
@@ -85,6 +108,77 @@ TEST_CASE("hash") {
     hash_free(&hash, NULL);
   }
 
+  SECTION("hash_upsert inserts or overwrites") {
+    hash_t hash = {};
+    hash_upsert(&hash, 25, 1, NULL);
+    CHECK(hash_count(&hash) == 1);
+    CHECK(hash_lookup(&hash, 25, 0) == 1);
+    hash_upsert(&hash, 25, 2, NULL);
+    CHECK(hash_count(&hash) == 1);
+    CHECK(hash_lookup(&hash, 25, 0) == 2);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("hash_find_or_insert returns the value slot and whether it was inserted") {
+    hash_t hash = {};
+    bool inserted = false;
+    uint32_t* value = hash_find_or_insert(&hash, 25, 7, &inserted, NULL);
+    CHECK(inserted);
+    CHECK(*value == 7);
+    *value = 8;
+    value = hash_find_or_insert(&hash, 25, 7, &inserted, NULL);
+    CHECK(!inserted);
+    CHECK(*value == 8);
+    CHECK(hash_count(&hash) == 1);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("hash_find_or_insert counts occurrences through growth") {
+    hash_t hash = {};
+    bool inserted;
+    for (uint32_t index = 0; index < 3000; ++index) {
+      ++*hash_find_or_insert(&hash, (index % 1000) + 1, 0, &inserted, NULL);
+    }
+    CHECK(hash_count(&hash) == 1000);
+    bool ok = true;
+    for (uint32_t key = 1; key <= 1000; ++key) {
+      ok = ok && (hash_lookup(&hash, key, 0) == 3);
+    }
+    CHECK(ok);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("hash_find_or_insert and hash_upsert only grow for new keys") {
+    hash_t hash = {};
+    bool inserted;
+    bool ok = true;
+    hash_insert(&hash, 1, 1, NULL);
+    for (uint32_t key = 2; key < 1000; ++key) {
+      const uint32_t capacity = hash_capacity(&hash);
+      ++*hash_find_or_insert(&hash, 1, 0, &inserted, NULL);
+      hash_upsert(&hash, key - 1, key, NULL);
+      ok = ok && !inserted && hash_capacity(&hash) == capacity;
+      hash_insert(&hash, key, key, NULL);
+    }
+    CHECK(ok);
+    CHECK(hash_count(&hash) == 999);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("hash_find_or_insert does robin hood hashing") {
+    hash_t hash = {};
+    bool inserted;
+    hash_insert(&hash, 1, 1, NULL);
+    hash_insert(&hash, 2, 2, NULL);
+    uint32_t* value = hash_find_or_insert(&hash, 129, 129, &inserted, NULL);
+    CHECK(value == &hash.values[2]);
+    CHECK(hash.keys[1] == 1);
+    CHECK(hash.keys[2] == 129);
+    CHECK(hash.keys[3] == 2);
+    CHECK(hash.values[3] == 2);
+    hash_free(&hash, NULL);
+  }
+
   SECTION("hash_insert does robin hood hashing") {
     hash_t hash = {};
     hash_insert(&hash, 1, 1, NULL);
@@ -97,6 +191,499 @@ TEST_CASE("hash") {
   }
 }
 
+TEST_CASE("hash with filter") {
+  init_t init(NULL);
+
+  SECTION("lookups agree with the unfiltered table through growth and removal") {
+    hash_t hash = {};
+    hash_filter_enable(&hash, 0, NULL);
+    CHECK(!hash_contains(&hash, 5));
+    for (uint32_t key = 1; key <= 5000; ++key) {
+      hash_insert(&hash, key * 2, key, NULL);
+    }
+    CHECK(hash.filter != NULL);
+    for (uint32_t key = 1; key <= 4000; ++key) {
+      hash_remove(&hash, key * 2);
+    }
+    bool ok = true;
+    for (uint32_t key = 1; key <= 10000; ++key) {
+      const bool expected = (key % 2 == 0) && key > 8000;
+      ok = ok && (hash_contains(&hash, key) == expected);
+      ok = ok && (hash_lookup(&hash, key, 0) == (expected ? key / 2 : 0));
+    }
+    CHECK(ok);
+    hash_free(&hash, NULL);
+    CHECK(hash.filter == NULL);
+  }
+
+  SECTION("hash_filter_enable covers keys already in the table") {
+    hash_t hash = {};
+    bool inserted;
+    hash_insert(&hash, 10, 1, NULL);
+    hash_filter_enable(&hash, 16, NULL);
+    *hash_find_or_insert(&hash, 20, 2, &inserted, NULL) = 2;
+    CHECK(hash_lookup(&hash, 10, 0) == 1);
+    CHECK(hash_lookup(&hash, 20, 0) == 2);
+    hash_filter_disable(&hash, NULL);
+    CHECK(hash_lookup(&hash, 10, 0) == 1);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("the filter rejects most absent keys") {
+    hash_t hash = {};
+    hash_reserve(&hash, 1 << 14, NULL);
+    hash_filter_enable(&hash, 10, NULL);
+    for (uint32_t key = 1; key <= 14000; ++key) {
+      hash_insert(&hash, key * 2654435761u, key, NULL);
+    }
+    // point the table at buckets that all hold the probe key, so a lookup only fails if the filter rejects it
+    uint32_t* keys = hash.keys;
+    std::vector<uint32_t> decoy(hash_capacity(&hash));
+    hash.keys = decoy.data();
+    uint32_t passed = 0;
+    for (uint32_t key = 1; key <= 2000; ++key) {
+      const uint32_t absent = key * 2654435761u + 1;
+      std::fill(decoy.begin(), decoy.end(), absent);
+      passed += hash_contains(&hash, absent) ? 1 : 0;
+    }
+    hash.keys = keys;
+    CHECK(passed < 100);
+    hash_free(&hash, NULL);
+  }
+}
+
+TEST_CASE("hash iteration") {
+  init_t init(NULL);
+
+  SECTION("hash_iter_next handles an empty table") {
+    hash_t hash = {};
+    hash_iter_t iter;
+    hash_iter_init(&hash, &iter, 0, 1);
+    CHECK(!hash_iter_next(&hash, &iter));
+  }
+
+  SECTION("hash_iter_next visits every key once") {
+    hash_t hash = {};
+    for (uint32_t key = 1; key <= 500; ++key) {
+      hash_insert(&hash, key * 3, key, NULL);
+    }
+    std::vector<uint32_t> seen(501, 0);
+    hash_iter_t iter;
+    hash_iter_init(&hash, &iter, 0, 1);
+    while (hash_iter_next(&hash, &iter)) {
+      CHECK(iter.key == iter.value * 3);
+      CHECK(hash.keys[iter.index] == iter.key);
+      ++seen[iter.value];
+    }
+    CHECK(std::count(seen.begin() + 1, seen.end(), 1) == 500);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("chunks partition the keys") {
+    hash_t hash = {};
+    for (uint32_t key = 1; key <= 500; ++key) {
+      hash_insert(&hash, key * 3, key, NULL);
+    }
+    std::vector<uint32_t> seen(501, 0);
+    for (uint32_t chunk = 0; chunk < 7; ++chunk) {
+      hash_iter_t iter;
+      hash_iter_init(&hash, &iter, chunk, 7);
+      while (hash_iter_next(&hash, &iter)) {
+        ++seen[iter.value];
+      }
+    }
+    CHECK(std::count(seen.begin() + 1, seen.end(), 1) == 500);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("hash_iter_remove keeps visiting every key once, including clusters that wrap") {
+    hash_t hash = {};
+    // keys that all want the last buckets so their cluster wraps around to the front of the table
+    for (uint32_t key = 1; key <= 20; ++key) {
+      hash_insert(&hash, 128 * key + 120, key, NULL);
+      hash_insert(&hash, key, key + 100, NULL);
+    }
+    std::vector<uint32_t> seen(200, 0);
+    hash_iter_t iter;
+    hash_iter_init(&hash, &iter, 0, 1);
+    while (hash_iter_next(&hash, &iter)) {
+      ++seen[iter.value];
+      if (iter.value % 2 == 0) {
+        hash_iter_remove(&hash, &iter);
+      }
+    }
+    CHECK(std::count(seen.begin(), seen.end(), 1) == 40);
+    CHECK(std::count(seen.begin(), seen.end(), 0) == 160);
+    CHECK(hash_count(&hash) == 20);
+    bool ok = true;
+    for (uint32_t key = 1; key <= 20; ++key) {
+      ok = ok && (hash_contains(&hash, 128 * key + 120) == (key % 2 == 1));
+      ok = ok && (hash_contains(&hash, key) == (key % 2 == 1));
+    }
+    CHECK(ok);
+    hash_free(&hash, NULL);
+  }
+}
+
+TEST_CASE("hash frozen") {
+  init_t init(NULL);
+
+  SECTION("hash_freeze handles an empty table") {
+    hash_t hash = {};
+    hash_frozen_t frozen;
+    hash_freeze(&hash, &frozen, NULL);
+    CHECK(hash_frozen_count(&frozen) == 0);
+    CHECK(hash_frozen_lookup(&frozen, 1, 7) == 7);
+    CHECK(!hash_frozen_contains(&frozen, 1));
+    hash_frozen_free(&frozen, NULL);
+  }
+
+  SECTION("lookups agree with the source table") {
+    for (uint32_t count : {1u, 9u, 1000u, 100000u}) {
+      hash_t hash = {};
+      for (uint32_t key = 1; key <= count; ++key) {
+        hash_insert(&hash, key * 2654435761u | 1, key, NULL);
+      }
+      hash_frozen_t frozen;
+      hash_freeze(&hash, &frozen, NULL);
+      REQUIRE(hash_frozen_count(&frozen) == count);
+      REQUIRE((uintptr_t)frozen.buckets % CONTAINERS_CACHE_LINE_SIZE == 0);
+      uint32_t mismatches = 0;
+      for (uint32_t key = 1; key <= count; ++key) {
+        mismatches += hash_frozen_lookup(&frozen, key * 2654435761u | 1, 0) != key;
+        mismatches += hash_frozen_contains(&frozen, key * 2u) ? 1 : 0;
+      }
+      CHECK(mismatches == 0);
+      hash_frozen_free(&frozen, NULL);
+      hash_free(&hash, NULL);
+    }
+  }
+
+  SECTION("it is smaller than the source table") {
+    hash_t hash = {};
+    for (uint32_t key = 1; key <= 100000; ++key) {
+      hash_insert(&hash, key, key, NULL);
+    }
+    hash_frozen_t frozen;
+    hash_freeze(&hash, &frozen, NULL);
+    const size_t hash_bytes = hash_capacity(&hash) * 2 * sizeof(uint32_t);
+    CHECK(hash_frozen_size_bytes(&frozen) < hash_bytes * 85 / 100);
+    CHECK(hash_frozen_size_bytes(&frozen) < 100000 * 2 * sizeof(uint32_t) * 110 / 100);
+    hash_frozen_free(&frozen, NULL);
+    hash_free(&hash, NULL);
+  }
+}
+
+TEST_CASE("hash_set") {
+  init_t init(NULL);
+
+  SECTION("it can insert and test containment") {
+    hash_set_t set = {};
+    CHECK(hash_set_count(&set) == 0);
+    CHECK(!hash_set_contains(&set, 25));
+    CHECK(hash_set_insert(&set, 25, NULL));
+    CHECK(hash_set_count(&set) == 1);
+    CHECK(hash_set_contains(&set, 25));
+    CHECK(!hash_set_contains(&set, 26));
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("hash_set_insert ignores duplicates") {
+    hash_set_t set = {};
+    CHECK(hash_set_insert(&set, 25, NULL));
+    CHECK(!hash_set_insert(&set, 25, NULL));
+    CHECK(hash_set_count(&set) == 1);
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("hash_set_insert only grows for new keys") {
+    hash_set_t set = {};
+    bool ok = true;
+    hash_set_insert(&set, 1, NULL);
+    for (uint32_t key = 2; key < 1000; ++key) {
+      const uint32_t capacity = hash_set_capacity(&set);
+      ok = ok && !hash_set_insert(&set, key - 1, NULL) && hash_set_capacity(&set) == capacity;
+      hash_set_insert(&set, key, NULL);
+    }
+    CHECK(ok);
+    CHECK(hash_set_count(&set) == 999);
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("it can remove correctly") {
+    hash_set_t set = {};
+    hash_set_insert(&set, 25, NULL);
+    hash_set_insert(&set, 153, NULL);
+    CHECK(hash_set_remove(&set, 25));
+    CHECK(!hash_set_remove(&set, 25));
+    CHECK(hash_set_count(&set) == 1);
+    CHECK(!hash_set_contains(&set, 25));
+    CHECK(hash_set_contains(&set, 153));
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("hash_set_remove gracefully handles an empty set") {
+    hash_set_t set = {};
+    CHECK(!hash_set_remove(&set, 1234));
+    CHECK(hash_set_count(&set) == 0);
+  }
+
+  SECTION("hash_set_reserve rounds up to the next pow 2") {
+    hash_set_t set = {};
+    hash_set_reserve(&set, 300, NULL);
+    CHECK(hash_set_capacity(&set) == 512);
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("keys survive growth") {
+    hash_set_t set = {};
+    for (uint32_t key = 1; key < 1000; ++key) {
+      hash_set_insert(&set, key * 7919, NULL);
+    }
+    CHECK(hash_set_count(&set) == 999);
+    CHECK(hash_set_capacity(&set) == 2048);
+    bool ok = true;
+    for (uint32_t key = 1; key < 1000; ++key) {
+      ok = ok && hash_set_contains(&set, key * 7919);
+      ok = ok && !hash_set_contains(&set, key * 7919 + 1);
+    }
+    CHECK(ok);
+    hash_set_free(&set, NULL);
+  }
+}
+
+TEST_CASE("hash_small") {
+  init_t init(NULL);
+
+  SECTION("it can insert, lookup and remove") {
+    hash_small_t hash = {};
+    CHECK(hash_small_lookup(&hash, 25, 99) == 99);
+    CHECK(!hash_small_remove(&hash, 25, 1));
+    hash_small_insert(&hash, 25, 1, NULL);
+    hash_small_insert(&hash, 153, 2, NULL);
+    CHECK(hash_small_count(&hash) == 2);
+    CHECK(hash_small_capacity(&hash) == 8);
+    CHECK(hash_small_lookup(&hash, 25, 99) == 1);
+    CHECK(hash_small_lookup(&hash, 153, 99) == 2);
+    CHECK(!hash_small_contains(&hash, 26));
+    CHECK(!hash_small_remove(&hash, 25, 2));
+    CHECK(hash_small_remove(&hash, 25, 1));
+    CHECK(!hash_small_contains(&hash, 25));
+    CHECK(hash_small_lookup(&hash, 153, 99) == 2);
+    CHECK(hash_small_count(&hash) == 1);
+    hash_small_free(&hash, NULL);
+    CHECK(hash_small_capacity(&hash) == 0);
+  }
+
+  SECTION("buckets take 6 bytes, or 4 with fingerprints") {
+    hash_small_t keys = {};
+    hash_small_t fingerprints;
+    hash_small_init(&fingerprints, true);
+    hash_small_reserve(&keys, 128, NULL);
+    hash_small_reserve(&fingerprints, 128, NULL);
+    CHECK(hash_small_size_bytes(&keys) == 128 * 6);
+    CHECK(hash_small_size_bytes(&fingerprints) == 128 * 4);
+    hash_small_free(&keys, NULL);
+    hash_small_free(&fingerprints, NULL);
+    CHECK(fingerprints.fingerprints);
+  }
+
+  SECTION("entries survive growth and removal in both modes") {
+    for (bool use_fingerprints : {false, true}) {
+      hash_small_t hash;
+      hash_small_init(&hash, use_fingerprints);
+      uint64_t seed = 7;
+      std::vector<uint32_t> keys;
+      for (uint32_t value = 0; value < 5000; ++value) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        keys.push_back((uint32_t)(seed >> 32) | 1);
+        hash_small_insert(&hash, keys.back(), (uint16_t)value, NULL);
+      }
+      CHECK(hash_small_count(&hash) == 5000);
+      CHECK(hash_small_capacity(&hash) == 8192);
+      for (uint32_t value = 0; value < 5000; value += 2) {
+        CHECK(hash_small_remove(&hash, keys[value], (uint16_t)value));
+      }
+      CHECK(hash_small_count(&hash) == 2500);
+
+      // every remaining key is found among its candidates, and removed keys are not
+      bool all_found = true;
+      bool removed_gone = true;
+      for (uint32_t value = 0; value < 5000; ++value) {
+        bool found = false;
+        uint32_t cursor = 0;
+        for (uint32_t candidate = hash_small_find_next(&hash, keys[value], &cursor); candidate != HASH_SMALL_NONE; candidate = hash_small_find_next(&hash, keys[value], &cursor)) {
+          found = found || (candidate == value);
+        }
+        if (value % 2 == 0) {
+          removed_gone = removed_gone && !found;
+        }
+        else {
+          all_found = all_found && found;
+        }
+      }
+      CHECK(all_found);
+      CHECK(removed_gone);
+      hash_small_free(&hash, NULL);
+    }
+  }
+
+  SECTION("keys that share a fingerprint are told apart by value") {
+    hash_small_t hash;
+    hash_small_init(&hash, true);
+    hash_small_insert(&hash, 0x00010005, 1, NULL);
+    hash_small_insert(&hash, 0x00020005, 2, NULL);
+    hash_small_insert(&hash, 0x00030005, 3, NULL);
+    uint32_t cursor = 0;
+    uint32_t seen = 0;
+    for (uint32_t candidate = hash_small_find_next(&hash, 0x00020005, &cursor); candidate != HASH_SMALL_NONE; candidate = hash_small_find_next(&hash, 0x00020005, &cursor)) {
+      seen |= 1u << candidate;
+    }
+    CHECK(seen == 0xe);
+    CHECK(hash_small_remove(&hash, 0x00010005, 2));
+    CHECK(hash_small_count(&hash) == 2);
+    CHECK(hash_small_lookup(&hash, 0x00020005, 99) != 2);
+
+    // the low 16 bits being 0 still works
+    hash_small_insert(&hash, 0x00070000, 4, NULL);
+    CHECK(hash_small_lookup(&hash, 0x00070000, 99) == 4);
+    hash_small_free(&hash, NULL);
+  }
+}
+
+TEST_CASE("hash allocation") {
+  SECTION("the tables are cache line aligned") {
+    init_t init(NULL);
+    hash_t hash = {};
+    hash_set_t set = {};
+    hash_insert(&hash, 1, 1, NULL);
+    hash_set_insert(&set, 1, NULL);
+    CHECK((uintptr_t)hash.keys % CONTAINERS_CACHE_LINE_SIZE == 0);
+    CHECK((uintptr_t)hash.values % CONTAINERS_CACHE_LINE_SIZE == 0);
+    CHECK((uintptr_t)set.keys % CONTAINERS_CACHE_LINE_SIZE == 0);
+    hash_free(&hash, NULL);
+    hash_set_free(&set, NULL);
+  }
+
+  SECTION("tables above the threshold take the large path and keep working") {
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    config.large_alloc_threshold = 4096;
+    init_t init(&config);
+
+    hash_t hash = {};
+    for (uint32_t key = 1; key <= 100000; ++key) {
+      hash_insert(&hash, key, key * 3, NULL);
+    }
+    CHECK((uintptr_t)hash.keys % CONTAINERS_CACHE_LINE_SIZE == 0);
+    uint32_t mismatches = 0;
+    for (uint32_t key = 1; key <= 100000; ++key) {
+      mismatches += hash_lookup(&hash, key, 0) != key * 3;
+    }
+    CHECK(mismatches == 0);
+    hash_free(&hash, NULL);
+  }
+
+  SECTION("alloc_aligned gets the alignment and size class, and free_aligned gets them back") {
+    static uint32_t s_large;
+    static uint32_t s_small;
+    s_large = 0;
+    s_small = 0;
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    config.large_alloc_threshold = 4096;
+    config.alloc_aligned = [](size_t size, size_t alignment, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func) {
+      CHECK(alignment == CONTAINERS_CACHE_LINE_SIZE);
+      CHECK((size_class == CONTAINERS_SIZE_CLASS_LARGE) == (size >= 4096));
+      ++(size_class == CONTAINERS_SIZE_CLASS_LARGE ? s_large : s_small);
+      // keep the malloc pointer just before the aligned block
+      uint8_t* raw = (uint8_t*)malloc(size + alignment + sizeof(void*));
+      uint8_t* aligned = (uint8_t*)(((uintptr_t)raw + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+      ((void**)aligned)[-1] = raw;
+      return (void*)aligned;
+    };
+    config.free_aligned = [](void* ptr, size_t size, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func) {
+      CHECK((size_class == CONTAINERS_SIZE_CLASS_LARGE) == (size >= 4096));
+      --(size_class == CONTAINERS_SIZE_CLASS_LARGE ? s_large : s_small);
+      free(((void**)ptr)[-1]);
+    };
+    init_t init(&config);
+
+    hash_t hash = {};
+    hash_insert(&hash, 1, 1, NULL);
+    CHECK(s_small == 2);
+    CHECK(s_large == 0);
+    hash_reserve(&hash, 4096, NULL);
+    CHECK(s_small == 0);
+    CHECK(s_large == 2);
+    hash_free(&hash, NULL);
+    CHECK(s_large == 0);
+  }
+
+  SECTION("tables are freed the way they were allocated after the config changes") {
+    static uint32_t s_allocs;
+    static uint32_t s_frees;
+    s_allocs = 0;
+    s_frees = 0;
+    init_t init(NULL);
+
+    // a mapped large table and an aligned malloc small one
+    hash_t large = {};
+    hash_t small = {};
+    hash_reserve(&large, 1 << 20, NULL);
+    hash_insert(&small, 1, 1, NULL);
+
+    // a custom alloc makes new tables carved out of it, and the lower threshold would class both old tables as large
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    config.large_alloc_threshold = 256;
+    config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+      ++s_allocs;
+      return malloc(size);
+    };
+    config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+      ++s_frees;
+      free(ptr);
+    };
+    containers_lib_init(&config);
+
+    hash_t carved = {};
+    hash_insert(&carved, 1, 1, NULL);
+    CHECK(s_allocs == 2);
+    hash_free(&large, NULL);
+    hash_free(&small, NULL);
+    CHECK(s_frees == 0);
+    hash_free(&carved, NULL);
+    CHECK(s_frees == 2);
+
+    // and back: a carved table still finds the pointer alloc returned
+    hash_insert(&carved, 1, 1, NULL);
+    containers_lib_init(NULL);
+    hash_free(&carved, NULL);
+  }
+}
+
+TEST_CASE("hash profiling") {
+  init_t init(NULL);
+
+  SECTION("nothing is counted unless profiling was started") {
+    containers_profile_reset();
+    hash_t hash = {};
+    for (uint32_t key = 1; key <= 1000; ++key) {
+      hash_insert(&hash, key, key, NULL);
+    }
+    CHECK(hash_lookup(&hash, 5, 0) == 5);
+    hash_remove(&hash, 5);
+    for (int op = 0; op < CONTAINERS_PROFILE_OP_COUNT; ++op) {
+      containers_profile_stats_t stats;
+      containers_profile_read((containers_profile_op_t)op, &stats);
+      CHECK(stats.calls == 0);
+      CHECK(containers_profile_op_name((containers_profile_op_t)op) != NULL);
+    }
+    hash_free(&hash, NULL);
+  }
+}
+
 TEST_CASE("hash with custom alloc") {
   containers_lib_config_t config;
   containers_lib_config_init(&config);
@@ -128,4 +715,41 @@ TEST_CASE("hash with custom alloc") {
     hash_free(&hash_b, &allocator_b);
     CHECK(allocator_b == 0);
   }
+
+  SECTION("hash_set only allocates the key array") {
+    hash_set_t set = {};
+    uint32_t allocator = 0;
+    hash_set_insert(&set, 1, &allocator);
+    CHECK(allocator == 1);
+    hash_set_reserve(&set, 300, &allocator);
+    CHECK(allocator == 1);
+    hash_set_free(&set, &allocator);
+    CHECK(allocator == 0);
+  }
+
+  SECTION("hash_small allocates one block per table") {
+    hash_small_t hash = {};
+    uint32_t allocator = 0;
+    hash_small_insert(&hash, 1, 1, &allocator);
+    CHECK(allocator == 1);
+    hash_small_reserve(&hash, 300, &allocator);
+    CHECK(allocator == 1);
+    hash_small_free(&hash, &allocator);
+    CHECK(allocator == 0);
+  }
+
+  SECTION("hash_freeze allocates one block from the given allocator") {
+    hash_t hash = {};
+    uint32_t allocator_hash = 0;
+    uint32_t allocator_frozen = 0;
+    for (uint32_t key = 1; key <= 1000; ++key) {
+      hash_insert(&hash, key, key, &allocator_hash);
+    }
+    hash_frozen_t frozen;
+    hash_freeze(&hash, &frozen, &allocator_frozen);
+    CHECK(allocator_frozen == 1);
+    hash_frozen_free(&frozen, &allocator_frozen);
+    CHECK(allocator_frozen == 0);
+    hash_free(&hash, &allocator_hash);
+  }
 }
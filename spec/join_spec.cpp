@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "utils.h"
+
+// the pairs a nested loop join would produce, sorted
+static std::vector<std::pair<uint32_t, uint32_t>> reference_join(const uint32_t* build_keys, const uint32_t* probe_keys) {
+  std::vector<std::pair<uint32_t, uint32_t>> pairs;
+  std::vector<std::pair<uint32_t, uint32_t>> build;
+  for (uint32_t index = 0; index < array_count(build_keys); ++index) {
+    build.push_back({build_keys[index], index});
+  }
+  std::sort(build.begin(), build.end());
+  for (uint32_t index = 0; index < array_count(probe_keys); ++index) {
+    auto range = std::equal_range(build.begin(), build.end(), std::make_pair(probe_keys[index], 0u), [](const std::pair<uint32_t, uint32_t>& lhs, const std::pair<uint32_t, uint32_t>& rhs) { return lhs.first < rhs.first; });
+    for (auto it = range.first; it != range.second; ++it) {
+      pairs.push_back({it->second, index});
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+static std::vector<std::pair<uint32_t, uint32_t>> sorted_pairs(const uint32_t* build_indices, const uint32_t* probe_indices) {
+  std::vector<std::pair<uint32_t, uint32_t>> pairs;
+  for (uint32_t index = 0; index < array_count(build_indices); ++index) {
+    pairs.push_back({build_indices[index], probe_indices[index]});
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+// *build_count* build keys and *probe_count* probe keys drawn from *key_range* values, so duplicates are common
+static void make_keys(uint32_t build_count, uint32_t probe_count, uint32_t key_range, uint32_t** build_keys, uint32_t** probe_keys) {
+  uint64_t seed = build_count;
+  for (uint32_t index = 0; index < build_count + probe_count; ++index) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    const uint32_t key = (uint32_t)(seed >> 32) % key_range;
+    if (index < build_count) {
+      array_push(*build_keys, key, NULL);
+    }
+    else {
+      array_push(*probe_keys, key, NULL);
+    }
+  }
+}
+
+TEST_CASE("hash_join_u32") {
+  init_t init(NULL);
+
+  SECTION("empty inputs match nothing") {
+    uint32_t* keys = NULL;
+    array_push(keys, 1, NULL);
+    uint32_t* build_indices = NULL;
+    uint32_t* probe_indices = NULL;
+    CHECK(hash_join_u32(NULL, keys, &build_indices, &probe_indices, NULL) == 0);
+    CHECK(hash_join_u32(keys, NULL, &build_indices, &probe_indices, NULL) == 0);
+    CHECK(build_indices == NULL);
+    CHECK(probe_indices == NULL);
+    array_free(keys, NULL);
+  }
+
+  SECTION("duplicates on both sides produce every pair, and 0 is a key") {
+    uint32_t* build_keys = NULL;
+    uint32_t* probe_keys = NULL;
+    for (uint32_t key : {0u, 5u, 7u, 5u, 0xffffffffu}) {
+      array_push(build_keys, key, NULL);
+    }
+    for (uint32_t key : {5u, 3u, 0u, 5u, 0xffffffffu}) {
+      array_push(probe_keys, key, NULL);
+    }
+    uint32_t* build_indices = NULL;
+    uint32_t* probe_indices = NULL;
+    CHECK(hash_join_u32(build_keys, probe_keys, &build_indices, &probe_indices, NULL) == 6);
+    CHECK(array_count(probe_indices) == 6);
+    std::vector<std::pair<uint32_t, uint32_t>> expected = {{0, 2}, {1, 0}, {1, 3}, {3, 0}, {3, 3}, {4, 4}};
+    CHECK(sorted_pairs(build_indices, probe_indices) == expected);
+    array_free(build_keys, NULL);
+    array_free(probe_keys, NULL);
+    array_free(build_indices, NULL);
+    array_free(probe_indices, NULL);
+  }
+
+  SECTION("pairs are appended after what the outputs already hold") {
+    uint32_t* keys = NULL;
+    array_push(keys, 9, NULL);
+    uint32_t* build_indices = NULL;
+    uint32_t* probe_indices = NULL;
+    array_push(build_indices, 100, NULL);
+    array_push(probe_indices, 200, NULL);
+    CHECK(hash_join_u32(keys, keys, &build_indices, &probe_indices, NULL) == 1);
+    CHECK(array_count(build_indices) == 2);
+    CHECK(build_indices[0] == 100);
+    CHECK(build_indices[1] == 0);
+    CHECK(probe_indices[1] == 0);
+    array_free(keys, NULL);
+    array_free(build_indices, NULL);
+    array_free(probe_indices, NULL);
+  }
+
+  SECTION("large inputs are partitioned and still match the reference") {
+    uint32_t* build_keys = NULL;
+    uint32_t* probe_keys = NULL;
+    make_keys(100000, 150000, 200000, &build_keys, &probe_keys);
+    uint32_t* build_indices = NULL;
+    uint32_t* probe_indices = NULL;
+    const uint32_t matches = hash_join_u32(build_keys, probe_keys, &build_indices, &probe_indices, NULL);
+    const auto expected = reference_join(build_keys, probe_keys);
+    CHECK(matches == expected.size());
+    CHECK(sorted_pairs(build_indices, probe_indices) == expected);
+    array_free(build_keys, NULL);
+    array_free(probe_keys, NULL);
+    array_free(build_indices, NULL);
+    array_free(probe_indices, NULL);
+  }
+}
+
+TEST_CASE("hash_join_u32 with parallel_for") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.parallel_for = [](void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count) {
+    std::vector<std::thread> threads;
+    for (uint32_t job_index = 0; job_index < job_count; ++job_index) {
+      threads.emplace_back(job, context, job_index);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  config.job_count = 4;
+  init_t init(NULL);
+
+  SECTION("the output does not depend on the job count") {
+    uint32_t* build_keys = NULL;
+    uint32_t* probe_keys = NULL;
+    make_keys(200000, 200000, 100000, &build_keys, &probe_keys);
+    uint32_t* build_serial = NULL;
+    uint32_t* probe_serial = NULL;
+    hash_join_u32(build_keys, probe_keys, &build_serial, &probe_serial, NULL);
+    uint32_t* build_parallel = NULL;
+    uint32_t* probe_parallel = NULL;
+    containers_lib_init(&config);
+    hash_join_u32(build_keys, probe_keys, &build_parallel, &probe_parallel, NULL);
+    containers_lib_init(NULL);
+    CHECK(array_count(build_parallel) == array_count(build_serial));
+    CHECK(std::equal(build_serial, build_serial + array_count(build_serial), build_parallel));
+    CHECK(std::equal(probe_serial, probe_serial + array_count(probe_serial), probe_parallel));
+    CHECK(sorted_pairs(build_parallel, probe_parallel) == reference_join(build_keys, probe_keys));
+    array_free(build_keys, NULL);
+    array_free(probe_keys, NULL);
+    array_free(build_serial, NULL);
+    array_free(probe_serial, NULL);
+    array_free(build_parallel, NULL);
+    array_free(probe_parallel, NULL);
+  }
+}
+
+TEST_CASE("hash_join_u32 with custom alloc") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+    ++(*(uint32_t*)allocator);
+    return malloc(size);
+  };
+  config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+    --(*(uint32_t*)allocator);
+    free(ptr);
+  };
+  init_t init(&config);
+
+  SECTION("scratch memory is returned and only the outputs stay allocated") {
+    uint32_t allocator_keys = 0;
+    uint32_t* keys = NULL;
+    for (uint32_t key = 0; key < 20000; ++key) {
+      array_push(keys, key, &allocator_keys);
+    }
+    uint32_t allocator = 0;
+    uint32_t* build_indices = NULL;
+    uint32_t* probe_indices = NULL;
+    CHECK(hash_join_u32(keys, keys, &build_indices, &probe_indices, &allocator) == 20000);
+    CHECK(allocator == 2);
+    array_free(build_indices, &allocator);
+    array_free(probe_indices, &allocator);
+    CHECK(allocator == 0);
+    array_free(keys, &allocator_keys);
+  }
+}
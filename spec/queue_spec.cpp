@@ -0,0 +1,203 @@
+#include <thread>
+#include <vector>
+#include "utils.h"
+
+TEST_CASE("spsc_queue") {
+  init_t init(NULL);
+
+  SECTION("spsc_queue_init rounds up to the next pow 2") {
+    spsc_queue_t queue;
+    spsc_queue_init(&queue, 100, sizeof(uint32_t), NULL);
+    CHECK(queue.capacity == 128);
+    CHECK(spsc_queue_count(&queue) == 0);
+    spsc_queue_free(&queue, NULL);
+  }
+
+  SECTION("items come out in the order they went in") {
+    spsc_queue_t queue;
+    spsc_queue_init(&queue, 4, sizeof(uint32_t), NULL);
+    uint32_t item = 0;
+    CHECK(!spsc_queue_pop(&queue, &item));
+    for (uint32_t value = 1; value <= 4; ++value) {
+      CHECK(spsc_queue_push(&queue, &value));
+    }
+    uint32_t extra = 5;
+    CHECK(!spsc_queue_push(&queue, &extra));
+    CHECK(spsc_queue_count(&queue) == 4);
+    for (uint32_t value = 1; value <= 4; ++value) {
+      CHECK(spsc_queue_pop(&queue, &item));
+      CHECK(item == value);
+    }
+    CHECK(!spsc_queue_pop(&queue, &item));
+    spsc_queue_free(&queue, NULL);
+  }
+
+  SECTION("the _n variants transfer partial batches across the wrap point") {
+    spsc_queue_t queue;
+    spsc_queue_init(&queue, 8, sizeof(uint32_t), NULL);
+    uint32_t items[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint32_t out[10] = {};
+    CHECK(spsc_queue_push_n(&queue, items, 6) == 6);
+    CHECK(spsc_queue_pop_n(&queue, out, 4) == 4);
+    CHECK(spsc_queue_push_n(&queue, items + 6, 4) == 4);
+    CHECK(spsc_queue_push_n(&queue, items, 10) == 2);
+    CHECK(spsc_queue_pop_n(&queue, out, 10) == 8);
+    CHECK(out[0] == 5);
+    CHECK(out[1] == 6);
+    CHECK(out[2] == 7);
+    CHECK(out[5] == 10);
+    CHECK(out[6] == 1);
+    CHECK(out[7] == 2);
+    spsc_queue_free(&queue, NULL);
+  }
+
+  SECTION("a producer and consumer thread agree on the sequence") {
+    spsc_queue_t queue;
+    spsc_queue_init(&queue, 64, sizeof(uint32_t), NULL);
+    const uint32_t total = 100000;
+    std::thread producer([&queue, total]() {
+      for (uint32_t value = 0; value < total;) {
+        if (spsc_queue_push(&queue, &value)) {
+          ++value;
+        }
+        else {
+          std::this_thread::yield();
+        }
+      }
+    });
+    bool in_order = true;
+    for (uint32_t expected = 0; expected < total;) {
+      uint32_t item;
+      if (spsc_queue_pop(&queue, &item)) {
+        in_order = in_order && (item == expected);
+        ++expected;
+      }
+      else {
+        std::this_thread::yield();
+      }
+    }
+    producer.join();
+    CHECK(in_order);
+    spsc_queue_free(&queue, NULL);
+  }
+}
+
+TEST_CASE("mpmc_queue") {
+  init_t init(NULL);
+
+  SECTION("items come out in the order they went in") {
+    mpmc_queue_t queue;
+    mpmc_queue_init(&queue, 4, sizeof(uint32_t), NULL);
+    uint32_t item = 0;
+    CHECK(!mpmc_queue_pop(&queue, &item));
+    for (uint32_t value = 1; value <= 4; ++value) {
+      CHECK(mpmc_queue_push(&queue, &value));
+    }
+    uint32_t extra = 5;
+    CHECK(!mpmc_queue_push(&queue, &extra));
+    CHECK(mpmc_queue_count(&queue) == 4);
+    for (uint32_t value = 1; value <= 4; ++value) {
+      CHECK(mpmc_queue_pop(&queue, &item));
+      CHECK(item == value);
+    }
+    CHECK(!mpmc_queue_pop(&queue, &item));
+    mpmc_queue_free(&queue, NULL);
+  }
+
+  SECTION("the _n variants transfer partial batches across the wrap point") {
+    mpmc_queue_t queue;
+    mpmc_queue_init(&queue, 8, sizeof(uint32_t), NULL);
+    uint32_t items[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint32_t out[10] = {};
+    CHECK(mpmc_queue_push_n(&queue, items, 6) == 6);
+    CHECK(mpmc_queue_pop_n(&queue, out, 4) == 4);
+    CHECK(mpmc_queue_push_n(&queue, items + 6, 4) == 4);
+    CHECK(mpmc_queue_push_n(&queue, items, 10) == 2);
+    CHECK(mpmc_queue_pop_n(&queue, out, 10) == 8);
+    CHECK(out[0] == 5);
+    CHECK(out[1] == 6);
+    CHECK(out[2] == 7);
+    CHECK(out[5] == 10);
+    CHECK(out[6] == 1);
+    CHECK(out[7] == 2);
+    mpmc_queue_free(&queue, NULL);
+  }
+
+  SECTION("every item is delivered exactly once across threads") {
+    mpmc_queue_t queue;
+    mpmc_queue_init(&queue, 128, sizeof(uint32_t), NULL);
+    const uint32_t thread_count = 4;
+    const uint32_t per_thread = 20000;
+    std::vector<uint32_t> seen(thread_count * per_thread, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+      threads.emplace_back([&queue, thread_index, per_thread]() {
+        for (uint32_t offset = 0; offset < per_thread;) {
+          uint32_t value = thread_index * per_thread + offset;
+          if (mpmc_queue_push(&queue, &value)) {
+            ++offset;
+          }
+          else {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    std::vector<uint32_t> popped_per_thread(thread_count, 0);
+    for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+      threads.emplace_back([&queue, &seen, &popped_per_thread, thread_index, per_thread]() {
+        uint32_t batch[16];
+        while (popped_per_thread[thread_index] < per_thread) {
+          uint32_t want = per_thread - popped_per_thread[thread_index];
+          const uint32_t popped = mpmc_queue_pop_n(&queue, batch, want < 16 ? want : 16);
+          for (uint32_t index = 0; index < popped; ++index) {
+            ++seen[batch[index]];
+          }
+          popped_per_thread[thread_index] += popped;
+          if (popped == 0) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    bool exactly_once = true;
+    for (uint32_t count : seen) {
+      exactly_once = exactly_once && (count == 1);
+    }
+    CHECK(exactly_once);
+    CHECK(mpmc_queue_count(&queue) == 0);
+    mpmc_queue_free(&queue, NULL);
+  }
+}
+
+TEST_CASE("queue with custom alloc") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+    ++(*(uint32_t*)allocator);
+    return malloc(size);
+  };
+  config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+    --(*(uint32_t*)allocator);
+    free(ptr);
+  };
+  init_t init(&config);
+
+  SECTION("the allocator is passed to the alloc and free funcs") {
+    uint32_t allocator_spsc = 0;
+    uint32_t allocator_mpmc = 0;
+    spsc_queue_t spsc;
+    mpmc_queue_t mpmc;
+    spsc_queue_init(&spsc, 16, sizeof(uint32_t), &allocator_spsc);
+    CHECK(allocator_spsc == 1);
+    mpmc_queue_init(&mpmc, 16, sizeof(uint32_t), &allocator_mpmc);
+    CHECK(allocator_mpmc == 2);
+    spsc_queue_free(&spsc, &allocator_spsc);
+    CHECK(allocator_spsc == 0);
+    mpmc_queue_free(&mpmc, &allocator_mpmc);
+    CHECK(allocator_mpmc == 0);
+  }
+}
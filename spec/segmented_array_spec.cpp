@@ -0,0 +1,158 @@
+#include <thread>
+#include <vector>
+#include "utils.h"
+
+TEST_CASE("segmented_array") {
+  init_t init(NULL);
+
+  SECTION("segmented_array_init allocates nothing") {
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint32_t));
+    CHECK(segmented_array_count(&arr) == 0);
+    for (uint32_t segment = 0; segment < SEGMENTED_ARRAY_SEGMENT_COUNT; ++segment) {
+      CHECK(arr.segments[segment] == NULL);
+    }
+    segmented_array_free(&arr, NULL);
+  }
+
+  SECTION("pushes return consecutive indices across segment boundaries") {
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint32_t));
+    bool in_order = true;
+    for (uint32_t value = 0; value < 10000; ++value) {
+      in_order = in_order && (segmented_array_push(&arr, &value, NULL) == value);
+    }
+    CHECK(in_order);
+    CHECK(segmented_array_count(&arr) == 10000);
+    CHECK(arr.segments[3] != NULL);
+    CHECK(arr.segments[4] == NULL);
+    bool all_found = true;
+    for (uint32_t value = 0; value < 10000; ++value) {
+      all_found = all_found && (*(uint32_t*)segmented_array_at(&arr, value) == value);
+    }
+    CHECK(all_found);
+    segmented_array_free(&arr, NULL);
+    CHECK(segmented_array_count(&arr) == 0);
+    CHECK(arr.item_size == sizeof(uint32_t));
+  }
+
+  SECTION("push_n splits a run that straddles segments") {
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint64_t));
+    std::vector<uint64_t> items(5000);
+    for (uint32_t index = 0; index < 5000; ++index) {
+      items[index] = (uint64_t)index << 32 | index;
+    }
+    CHECK(segmented_array_push_n(&arr, items.data(), 1000, NULL) == 0);
+    CHECK(segmented_array_push_n(&arr, items.data() + 1000, 4000, NULL) == 1000);
+    CHECK(segmented_array_count(&arr) == 5000);
+    bool all_found = true;
+    for (uint32_t index = 0; index < 5000; ++index) {
+      all_found = all_found && (*(uint64_t*)segmented_array_at(&arr, index) == items[index]);
+    }
+    CHECK(all_found);
+    segmented_array_free(&arr, NULL);
+  }
+
+  SECTION("pointers stay valid while the array grows") {
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint32_t));
+    uint32_t first = 42;
+    segmented_array_push(&arr, &first, NULL);
+    const uint32_t* pointer = (const uint32_t*)segmented_array_at(&arr, 0);
+    for (uint32_t value = 0; value < 100000; ++value) {
+      segmented_array_push(&arr, &value, NULL);
+    }
+    CHECK(pointer == segmented_array_at(&arr, 0));
+    CHECK(*pointer == 42);
+    segmented_array_free(&arr, NULL);
+  }
+
+  SECTION("concurrent pushes land every item exactly once") {
+    // each item carries its value and the complement, so a slot read before it was written shows up as a mismatch
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint64_t));
+    const uint32_t thread_count = 4;
+    const uint32_t per_thread = 50000;
+    const uint32_t total = thread_count * per_thread;
+    std::vector<std::thread> threads;
+    for (uint32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+      threads.emplace_back([&arr, thread_index, per_thread]() {
+        uint64_t batch[7];
+        for (uint32_t offset = 0; offset < per_thread;) {
+          // mix single and batched pushes so runs interleave
+          const uint32_t run = (offset % 3 == 0 || per_thread - offset < 7) ? 1 : 7;
+          for (uint32_t index = 0; index < run; ++index) {
+            const uint32_t value = thread_index * per_thread + offset + index;
+            batch[index] = (uint64_t)~value << 32 | value;
+          }
+          segmented_array_push_n(&arr, batch, run, NULL);
+          offset += run;
+          if (offset % 1024 < run) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    bool prefix_written = true;
+    std::thread reader([&arr, &prefix_written, total]() {
+      uint32_t checked = 0;
+      while (checked < total) {
+        const uint32_t count = segmented_array_count(&arr);
+        for (; checked < count; ++checked) {
+          const uint64_t item = *(const uint64_t*)segmented_array_at(&arr, checked);
+          prefix_written = prefix_written && ((uint32_t)(item >> 32) == ~(uint32_t)item);
+        }
+        std::this_thread::yield();
+      }
+    });
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    reader.join();
+    CHECK(prefix_written);
+    CHECK(segmented_array_count(&arr) == total);
+    std::vector<uint32_t> seen(total, 0);
+    for (uint32_t index = 0; index < total; ++index) {
+      const uint32_t value = (uint32_t)*(const uint64_t*)segmented_array_at(&arr, index);
+      if (value < total) {
+        ++seen[value];
+      }
+    }
+    bool exactly_once = true;
+    for (uint32_t count : seen) {
+      exactly_once = exactly_once && (count == 1);
+    }
+    CHECK(exactly_once);
+    segmented_array_free(&arr, NULL);
+  }
+}
+
+TEST_CASE("segmented_array with custom alloc") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+    ++(*(uint32_t*)allocator);
+    return malloc(size);
+  };
+  config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+    --(*(uint32_t*)allocator);
+    free(ptr);
+  };
+  init_t init(&config);
+
+  SECTION("each segment is one allocation from the given allocator") {
+    uint32_t allocator = 0;
+    segmented_array_t arr;
+    segmented_array_init(&arr, sizeof(uint32_t));
+    CHECK(allocator == 0);
+    for (uint32_t value = 0; value < 3000; ++value) {
+      segmented_array_push(&arr, &value, &allocator);
+    }
+    CHECK(allocator == 2);
+    segmented_array_free(&arr, &allocator);
+    CHECK(allocator == 0);
+  }
+}
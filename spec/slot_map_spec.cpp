@@ -0,0 +1,141 @@
+#include <vector>
+#include "utils.h"
+
+TEST_CASE("slot_map") {
+  init_t init(NULL);
+
+  SECTION("slot_map_init allocates nothing") {
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint32_t));
+    CHECK(slot_map_count(&map) == 0);
+    CHECK(map.values == NULL);
+    CHECK(!slot_map_contains(&map, SLOT_MAP_HANDLE_NONE));
+    CHECK(slot_map_get(&map, SLOT_MAP_HANDLE_NONE) == NULL);
+    slot_map_free(&map, NULL);
+  }
+
+  SECTION("handles find the items they were issued for") {
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint64_t));
+    std::vector<slot_map_handle_t> handles;
+    for (uint64_t value = 0; value < 1000; ++value) {
+      const uint64_t item = value * 3;
+      handles.push_back(slot_map_insert(&map, &item, NULL));
+    }
+    CHECK(slot_map_count(&map) == 1000);
+    bool all_found = true;
+    for (uint64_t value = 0; value < 1000; ++value) {
+      const uint64_t* item = (const uint64_t*)slot_map_get(&map, handles[value]);
+      all_found = all_found && item != NULL && *item == value * 3;
+    }
+    CHECK(all_found);
+    CHECK(handles[0] != SLOT_MAP_HANDLE_NONE);
+    slot_map_free(&map, NULL);
+    CHECK(slot_map_count(&map) == 0);
+    CHECK(!slot_map_contains(&map, handles[0]));
+  }
+
+  SECTION("removing keeps the items packed and the other handles valid") {
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint32_t));
+    slot_map_handle_t handles[4];
+    for (uint32_t value = 0; value < 4; ++value) {
+      handles[value] = slot_map_insert(&map, &value, NULL);
+    }
+    CHECK(slot_map_remove(&map, handles[1]));
+    CHECK(!slot_map_remove(&map, handles[1]));
+    CHECK(slot_map_count(&map) == 3);
+
+    // the last item moved into the hole
+    const uint32_t* values = (const uint32_t*)slot_map_values(&map);
+    CHECK(values[0] == 0);
+    CHECK(values[1] == 3);
+    CHECK(values[2] == 2);
+    CHECK(slot_map_handle_at(&map, 1) == handles[3]);
+    CHECK(*(uint32_t*)slot_map_get(&map, handles[3]) == 3);
+    CHECK(*(uint32_t*)slot_map_get(&map, handles[2]) == 2);
+    slot_map_free(&map, NULL);
+  }
+
+  SECTION("a reused slot rejects the stale handle") {
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint32_t));
+    uint32_t first = 1;
+    uint32_t second = 2;
+    const slot_map_handle_t stale = slot_map_insert(&map, &first, NULL);
+    slot_map_remove(&map, stale);
+    const slot_map_handle_t fresh = slot_map_insert(&map, &second, NULL);
+    CHECK((uint32_t)fresh == (uint32_t)stale);
+    CHECK(fresh != stale);
+    CHECK(!slot_map_contains(&map, stale));
+    CHECK(slot_map_get(&map, stale) == NULL);
+    CHECK(*(uint32_t*)slot_map_get(&map, fresh) == 2);
+
+    // a handle for the free slot's current generation is not live either
+    slot_map_remove(&map, fresh);
+    CHECK(!slot_map_contains(&map, fresh + (1ull << 32)));
+    CHECK(!slot_map_contains(&map, (uint64_t)7 << 32 | 99));
+    slot_map_free(&map, NULL);
+  }
+
+  SECTION("random inserts and removes match a reference") {
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint32_t));
+    std::vector<std::pair<slot_map_handle_t, uint32_t>> live;
+    uint64_t seed = 1;
+    for (uint32_t step = 0; step < 20000; ++step) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      const uint32_t random = (uint32_t)(seed >> 33);
+      if (live.empty() || random % 3 != 0) {
+        live.push_back({slot_map_insert(&map, &step, NULL), step});
+      }
+      else {
+        const size_t victim = random % live.size();
+        CHECK(slot_map_remove(&map, live[victim].first));
+        live[victim] = live.back();
+        live.pop_back();
+      }
+    }
+    CHECK(slot_map_count(&map) == live.size());
+    bool all_found = true;
+    for (const auto& entry : live) {
+      const uint32_t* item = (const uint32_t*)slot_map_get(&map, entry.first);
+      all_found = all_found && item != NULL && *item == entry.second;
+    }
+    CHECK(all_found);
+    bool handles_round_trip = true;
+    for (uint32_t index = 0; index < slot_map_count(&map); ++index) {
+      handles_round_trip = handles_round_trip && slot_map_get(&map, slot_map_handle_at(&map, index)) == (uint32_t*)slot_map_values(&map) + index;
+    }
+    CHECK(handles_round_trip);
+    slot_map_free(&map, NULL);
+  }
+}
+
+TEST_CASE("slot_map with custom alloc") {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+    ++(*(uint32_t*)allocator);
+    return malloc(size);
+  };
+  config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+    --(*(uint32_t*)allocator);
+    free(ptr);
+  };
+  init_t init(&config);
+
+  SECTION("the allocator is passed to the alloc and free funcs") {
+    uint32_t allocator = 0;
+    slot_map_t map;
+    slot_map_init(&map, sizeof(uint32_t));
+    slot_map_reserve(&map, 64, &allocator);
+    CHECK(allocator == 4);
+    for (uint32_t value = 0; value < 64; ++value) {
+      slot_map_insert(&map, &value, &allocator);
+    }
+    CHECK(allocator == 4);
+    slot_map_free(&map, &allocator);
+    CHECK(allocator == 0);
+  }
+}
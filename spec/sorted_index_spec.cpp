@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <vector>
+#include "utils.h"
+
+// builds a sorted array with runs of duplicates and both extreme keys
+static uint32_t* make_sorted(uint32_t count) {
+  uint32_t* arr = NULL;
+  uint64_t seed = count;
+  for (uint32_t index = 0; index < count; ++index) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    const uint32_t key = (uint32_t)(seed >> 32);
+    array_push(arr, (index % 7 == 0 && index > 0) ? arr[index - 1] : key, NULL);
+  }
+  std::sort(arr, arr + count);
+  if (count >= 2) {
+    arr[0] = 0;
+    arr[count - 1] = UINT32_MAX;
+  }
+  return arr;
+}
+
+TEST_CASE("sorted index") {
+  SECTION("it handles an empty array") {
+    for_each_simd_level([]() {
+      sorted_index_t index;
+      sorted_index_init(&index, NULL, NULL);
+      uint32_t begin = 7;
+      CHECK(sorted_index_count(&index) == 0);
+      CHECK(sorted_index_lower_bound(&index, 5) == 0);
+      CHECK(sorted_index_upper_bound(&index, 5) == 0);
+      CHECK(sorted_index_range(&index, 1, 9, &begin) == 0);
+      CHECK(begin == 0);
+      sorted_index_free(&index, NULL);
+    });
+  }
+
+  SECTION("bounds agree with std::lower_bound and std::upper_bound") {
+    for_each_simd_level([]() {
+      for (uint32_t count : {1u, 2u, 15u, 16u, 17u, 300u, 16u * 17u, 16u * 17u * 17u + 5u, 100000u}) {
+        uint32_t* arr = make_sorted(count);
+        sorted_index_t index;
+        sorted_index_init(&index, arr, NULL);
+        REQUIRE(sorted_index_count(&index) == count);
+        REQUIRE((uintptr_t)sorted_index_keys(&index) % CONTAINERS_CACHE_LINE_SIZE == 0);
+        REQUIRE(std::equal(arr, arr + count, sorted_index_keys(&index)));
+
+        // every key, its neighbours and the extremes
+        std::vector<uint32_t> values = {0, 1, UINT32_MAX - 1, UINT32_MAX};
+        for (uint32_t rank = 0; rank < count; ++rank) {
+          values.push_back(arr[rank]);
+          values.push_back(arr[rank] - 1);
+          values.push_back(arr[rank] + 1);
+        }
+        uint32_t mismatches = 0;
+        for (uint32_t value : values) {
+          mismatches += sorted_index_lower_bound(&index, value) != (uint32_t)(std::lower_bound(arr, arr + count, value) - arr);
+          mismatches += sorted_index_upper_bound(&index, value) != (uint32_t)(std::upper_bound(arr, arr + count, value) - arr);
+        }
+        CHECK(mismatches == 0);
+
+        sorted_index_free(&index, NULL);
+        array_free(arr, NULL);
+      }
+    });
+  }
+
+  SECTION("sorted_index_range finds the keys in the closed range") {
+    for_each_simd_level([]() {
+      uint32_t* arr = NULL;
+      for (uint32_t key : {2u, 4u, 4u, 4u, 6u, 8u, 10u}) {
+        array_push(arr, key, NULL);
+      }
+      sorted_index_t index;
+      sorted_index_init(&index, arr, NULL);
+      uint32_t begin;
+      CHECK(sorted_index_range(&index, 4, 8, &begin) == 5);
+      CHECK(begin == 1);
+      CHECK(sorted_index_range(&index, 5, 5, &begin) == 0);
+      CHECK(begin == 4);
+      CHECK(sorted_index_range(&index, 0, UINT32_MAX, &begin) == 7);
+      CHECK(begin == 0);
+      CHECK(sorted_index_range(&index, 9, 3, &begin) == 0);
+      sorted_index_free(&index, NULL);
+      array_free(arr, NULL);
+    });
+  }
+
+  SECTION("it allocates one block from the given allocator") {
+    containers_lib_config_t config;
+    containers_lib_config_init(&config);
+    config.alloc = [](size_t size, void* allocator, const char* file, int line, const char* func) {
+      ++(*(uint32_t*)allocator);
+      return malloc(size);
+    };
+    config.free = [](void* ptr, void* allocator, const char* file, int line, const char* func) {
+      --(*(uint32_t*)allocator);
+      free(ptr);
+    };
+    init_t init(&config);
+
+    uint32_t allocator_arr = 0;
+    uint32_t* arr = NULL;
+    for (uint32_t key = 0; key < 1000; ++key) {
+      array_push(arr, key, &allocator_arr);
+    }
+    uint32_t allocator = 0;
+    sorted_index_t index;
+    sorted_index_init(&index, arr, &allocator);
+    CHECK(allocator == 1);
+    sorted_index_free(&index, &allocator);
+    CHECK(allocator == 0);
+    array_free(arr, &allocator_arr);
+  }
+}
@@ -6,3 +6,17 @@ struct init_t {
   init_t(containers_lib_config_t* config);
   ~init_t();
 };
+
+// runs *test* once for every instruction set the search kernels can use on this cpu
+template <typename test_t>
+inline void for_each_simd_level(test_t test) {
+  containers_lib_config_t config;
+  containers_lib_config_init(&config);
+  for (int level = CONTAINERS_SIMD_SCALAR; level <= CONTAINERS_SIMD_AVX512; ++level) {
+    config.simd_level = (containers_simd_t)level;
+    init_t init(&config);
+    if (containers_lib_simd_level() == level) {
+      test();
+    }
+  }
+}
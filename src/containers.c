@@ -1,12 +1,131 @@
+// mmap's MAP_ANONYMOUS and syscall are extensions that strict -std=c11 builds of glibc hide
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "containers.h"
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#define CONTAINERS_LINUX 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(CONTAINERS_PROFILE_ENABLED) && defined(CONTAINERS_LINUX)
+#define CONTAINERS_PROFILE_PERF 1
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CONTAINERS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CONTAINERS_TARGET_AVX2
+#define CONTAINERS_TARGET_AVX512
+#else
+#define CONTAINERS_TARGET_AVX2 __attribute__((target("avx2")))
+#define CONTAINERS_TARGET_AVX512 __attribute__((target("avx512f,avx2,popcnt")))
+#endif
+#endif
+
+// Builds can bind the allocator and assert handler at compile time (so they can be inlined, e.g. mimalloc or an arena)
+// by defining CONTAINERS_USER_CONFIG as the path of a header that defines any of
+//
+//   CONTAINERS_ALLOC(size, allocator, file, line, func)
+//   CONTAINERS_FREE(ptr, allocator, file, line, func)
+//   CONTAINERS_ALLOC_ALIGNED(size, alignment, size_class, allocator, file, line, func)
+//   CONTAINERS_FREE_ALIGNED(ptr, size, size_class, allocator, file, line, func)
+//   CONTAINERS_ASSERT_FAILED(expression, message, file, line, func)
+//
+// with the same meaning as the containers_lib_config_t functions. Anything left undefined goes through the config set
+// by containers_lib_init.
+#ifdef CONTAINERS_USER_CONFIG
+#include CONTAINERS_USER_CONFIG
+#endif
+
+// the built-in aligned allocator only bypasses alloc/free when those are the malloc based defaults
+#ifdef CONTAINERS_ALLOC
+#define CONTAINERS_ALLOC_BOUND 1
+#endif
+#ifdef CONTAINERS_ALLOC_ALIGNED
+#define CONTAINERS_ALLOC_ALIGNED_BOUND 1
+#endif
+
+#ifndef CONTAINERS_ALLOC
+#define CONTAINERS_ALLOC(size, allocator, file, line, func) s_config.alloc(size, allocator, file, line, func)
+#endif
+#ifndef CONTAINERS_FREE
+#define CONTAINERS_FREE(ptr, allocator, file, line, func) s_config.free(ptr, allocator, file, line, func)
+#endif
+#ifndef CONTAINERS_ALLOC_ALIGNED
+#define CONTAINERS_ALLOC_ALIGNED(size, alignment, size_class, allocator, file, line, func) s_config.alloc_aligned(size, alignment, size_class, allocator, file, line, func)
+#endif
+#ifndef CONTAINERS_FREE_ALIGNED
+#define CONTAINERS_FREE_ALIGNED(ptr, size, size_class, allocator, file, line, func) s_config.free_aligned(ptr, size, size_class, allocator, file, line, func)
+#endif
+#ifndef CONTAINERS_ASSERT_FAILED
+#define CONTAINERS_ASSERT_FAILED(expression, message, file, line, func) s_config.assert_failed(expression, message, file, line, func)
+#endif
+
 static const uint32_t HASH_INITIAL_CAPACITY = 128;
 static const uint32_t HASH_LOAD_FACTOR_PERCENT = 90;
+static const uint32_t HASH_INDEX_NONE = 0xffffffff;
+static const uint32_t PARALLEL_MIN_ITEMS_PER_JOB = 16384;
+static const uint32_t HASH_FILTER_DEFAULT_BITS_PER_KEY = 10;
+static const uint32_t HASH_FILTER_WORDS_PER_BLOCK = 8;
+static const uint32_t HASH_FROZEN_SLOTS = 8;
+static const uint32_t HASH_FROZEN_BUCKET_WORDS = 16;
+static const uint32_t HASH_FROZEN_LOAD_FACTOR_PERCENT = 96;
+static const uint32_t HASH_FROZEN_MAX_KICKS = 512;
+static const uint32_t SORTED_INDEX_NODE_KEYS = 16;
+static const uint32_t SORTED_INDEX_FANOUT = 17;
+static const uint32_t SEGMENTED_ARRAY_FIRST_SEGMENT_BITS = 10;
+static const uint32_t SLOT_MAP_SLOT_NONE = 0xffffffff;
+static const uint32_t HASH_SMALL_INITIAL_CAPACITY = 8;
+#ifdef CONTAINERS_CHECK_ENABLED
+static const uint32_t HASH_SMALL_MAX_CAPACITY = 65536;
+#endif
+static const uint32_t HASH_SMALL_SCAN_CAPACITY = 32;
+static const uint32_t JOIN_PARTITION_KEYS = 8192;
+static const uint32_t JOIN_MAX_RADIX_BITS = 10;
+static const uint32_t JOIN_NONE = 0xffffffff;
+static const uint8_t TABLE_CLASS_CARVED = 2; // past the containers_size_class_t values
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// the kernels picked at init time for the cpu
+typedef struct simd_kernels_t {
+  uint32_t (*find_u32)(const uint32_t* arr, uint32_t count, uint32_t value);
+  uint32_t (*find_u64)(const uint64_t* arr, uint32_t count, uint64_t value);
+  uint32_t (*find_f32)(const float* arr, uint32_t count, float value);
+  uint32_t (*count_u32)(const uint32_t* arr, uint32_t count, uint32_t value);
+  uint32_t (*count_u64)(const uint64_t* arr, uint32_t count, uint64_t value);
+  uint32_t (*count_f32)(const float* arr, uint32_t count, float value);
+  uint32_t (*min_u32)(const uint32_t* arr, uint32_t count);
+  uint32_t (*max_u32)(const uint32_t* arr, uint32_t count);
+  uint64_t (*min_u64)(const uint64_t* arr, uint32_t count);
+  uint64_t (*max_u64)(const uint64_t* arr, uint32_t count);
+  float (*min_f32)(const float* arr, uint32_t count);
+  float (*max_f32)(const float* arr, uint32_t count);
+  uint32_t (*compact_mask_32)(void* arr, uint32_t count, const uint64_t* mask);
+  uint32_t (*compact_mask_64)(void* arr, uint32_t count, const uint64_t* mask);
+  uint32_t (*find_not_u32)(const uint32_t* arr, uint32_t count, uint32_t value);
+  uint32_t (*sorted_index_rank)(const sorted_index_t* index, uint32_t value);
+} simd_kernels_t;
 
 static containers_lib_config_t s_config;
+static const simd_kernels_t* s_kernels;
+static containers_simd_t s_simd_level;
+
+static void simd_kernels_select(containers_simd_t level_requested);
 
 static void* default_alloc(size_t size_bytes, void* allocator, const char* file, int line, const char* func) {
   return malloc(size_bytes);
@@ -20,190 +139,419 @@ static void default_assert_failed(const char* expression, const char* message, c
   fprintf(stderr, "ASSERTION FAILED\nexpression: %s\nmessage: %s\nfile: %s\nline: %d\nfunction: %s\n", expression, message, file, line, func);
 }
 
-static uint32_t next_pow_2(uint32_t value) {
-  --value;
-  value |= (value >> 1);
-  value |= (value >> 2);
-  value |= (value >> 4);
-  value |= (value >> 8);
-  value |= (value >> 16);
-  ++value;
-  value += (value == 0);
+static size_t round_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// tests if alloc/free are the malloc based defaults, which the built-in aligned allocator is free to bypass
+static bool default_alloc_in_use() {
+#ifdef CONTAINERS_ALLOC_BOUND
+  return false;
+#else
+  return s_config.alloc == &default_alloc && s_config.free == &default_free;
+#endif
+}
+
+#ifdef CONTAINERS_LINUX
+// Maps whole huge pages, starting on a huge page boundary so every page can be backed by a transparent huge page, and
+// binds them to the configured numa node.
+static void* map_huge_pages(size_t size_bytes) {
+  const size_t size_mapped = round_up(size_bytes, HUGE_PAGE_SIZE);
+
+  // over-map by a huge page and trim the ends to get the alignment
+  uint8_t* region = (uint8_t*)mmap(NULL, size_mapped + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return NULL;
+  }
+  uint8_t* pages = (uint8_t*)round_up((uintptr_t)region, HUGE_PAGE_SIZE);
+  if (pages != region) {
+    munmap(region, (size_t)(pages - region));
+  }
+  if (pages + size_mapped != region + size_mapped + HUGE_PAGE_SIZE) {
+    munmap(pages + size_mapped, (size_t)(region + HUGE_PAGE_SIZE - pages));
+  }
+
+#ifdef MADV_HUGEPAGE
+  madvise(pages, size_mapped, MADV_HUGEPAGE);
+#endif
+  if (s_config.numa_node >= 0 && s_config.numa_node < 64) {
+    // mbind with MPOL_BIND (2); the kernel reads maxnode - 1 bits of the mask
+    const unsigned long node_mask = 1ul << s_config.numa_node;
+    syscall(SYS_mbind, pages, size_mapped, 2, &node_mask, sizeof(node_mask) * 8 + 1, 0);
+  }
+  return pages;
+}
+#endif
+
+// Blocks carved out of alloc (see table_alloc) never reach these, so they only deal with memory of their own.
+static void* default_alloc_aligned(size_t size_bytes, size_t alignment, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func) {
+#ifdef CONTAINERS_LINUX
+  if (size_class == CONTAINERS_SIZE_CLASS_LARGE) {
+    return map_huge_pages(size_bytes);
+  }
+#endif
+#if defined(_WIN32)
+  return _aligned_malloc(size_bytes, alignment);
+#else
+  void* ptr = NULL;
+  return posix_memalign(&ptr, alignment, size_bytes) == 0 ? ptr : NULL;
+#endif
+}
+
+static void default_free_aligned(void* ptr, size_t size_bytes, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func) {
+#ifdef CONTAINERS_LINUX
+  if (size_class == CONTAINERS_SIZE_CLASS_LARGE) {
+    munmap(ptr, round_up(size_bytes, HUGE_PAGE_SIZE));
+    return;
+  }
+#endif
+#if defined(_WIN32)
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#if defined(_M_IX86) || defined(_M_X64)
+// x86 does not reorder loads with loads or stores with stores, and a load after an interlocked operation (a full
+// barrier) is sequentially consistent, so plain aligned accesses only need the compiler barriers
+static uint32_t atomic_u32_load_relaxed(const uint32_t* ptr) {
+  return *(const volatile uint32_t*)ptr;
+}
+
+static uint32_t atomic_u32_load_acquire(const uint32_t* ptr) {
+  const uint32_t value = *(const volatile uint32_t*)ptr;
+  _ReadWriteBarrier();
   return value;
 }
 
-static void hash_insert_impl(hash_t* hash, uint32_t key, uint32_t value) {
-  ++hash->count;
+static void atomic_u32_store_release(uint32_t* ptr, uint32_t value) {
+  _ReadWriteBarrier();
+  *(volatile uint32_t*)ptr = value;
+}
 
-  uint32_t* keys = hash->keys;
-  uint32_t* values = hash->values;
-  const uint32_t capacity = hash->capacity;
-  const uint32_t mask = (capacity - 1);
+static uint32_t atomic_u32_load_seq_cst(const uint32_t* ptr) {
+  _ReadWriteBarrier();
+  const uint32_t value = *(const volatile uint32_t*)ptr;
+  _ReadWriteBarrier();
+  return value;
+}
 
-  const uint32_t index_desired = key & mask;
-  uint32_t index = index_desired;
-  uint32_t distance = 0;
-  for (;;) {
-    const uint32_t key_cur = keys[index];
-    // if the current index is empty, use it
-    if (key_cur == 0) {
-      keys[index] = key;
-      values[index] = value;
-      break;
-    }
+static void* atomic_ptr_load_acquire(void* const* ptr) {
+  void* value = *(void* const volatile*)ptr;
+  _ReadWriteBarrier();
+  return value;
+}
+#elif defined(_M_ARM64)
+// the hardware reorders plain accesses here, so acquire and release go through ldar/stlr (which are also sequentially
+// consistent with each other and with the interlocked operations)
+static uint32_t atomic_u32_load_relaxed(const uint32_t* ptr) {
+  return __iso_volatile_load32((const volatile __int32*)ptr);
+}
 
-    // if the existing element has probled less than us, swap places and look for a place for the existing element
-    const uint32_t distance_existing = (index + capacity - (key_cur & mask)) & mask;
-    if (distance_existing < distance) {
-      uint32_t tmp_key = keys[index];
-      uint32_t tmp_value = values[index];
-      keys[index] = key;
-      values[index] = value;
-      key = tmp_key;
-      value = tmp_value;
-      distance = distance_existing;
-    }
+static uint32_t atomic_u32_load_acquire(const uint32_t* ptr) {
+  return __ldar32((volatile unsigned __int32*)ptr);
+}
 
-    // linear probing
-    index = (index + 1) & mask;
-    ++distance;
+static void atomic_u32_store_release(uint32_t* ptr, uint32_t value) {
+  __stlr32((volatile unsigned __int32*)ptr, value);
+}
+
+static uint32_t atomic_u32_load_seq_cst(const uint32_t* ptr) {
+  return __ldar32((volatile unsigned __int32*)ptr);
+}
+
+static void* atomic_ptr_load_acquire(void* const* ptr) {
+  return (void*)__ldar64((volatile unsigned __int64*)ptr);
+}
+#else
+#error "containers: no atomics for this msvc target"
+#endif
+
+static bool atomic_u32_cas(uint32_t* ptr, uint32_t expected, uint32_t desired) {
+  return (uint32_t)_InterlockedCompareExchange((volatile long*)ptr, (long)desired, (long)expected) == expected;
+}
+
+static uint32_t atomic_u32_fetch_add(uint32_t* ptr, uint32_t value) {
+  return (uint32_t)_InterlockedExchangeAdd((volatile long*)ptr, (long)value);
+}
+
+static uint32_t atomic_u32_fetch_or(uint32_t* ptr, uint32_t value) {
+  return (uint32_t)_InterlockedOr((volatile long*)ptr, (long)value);
+}
+
+static bool atomic_ptr_cas(void** ptr, void* expected, void* desired) {
+  return _InterlockedCompareExchangePointer((void* volatile*)ptr, desired, expected) == expected;
+}
+#else
+static uint32_t atomic_u32_load_relaxed(const uint32_t* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static uint32_t atomic_u32_load_acquire(const uint32_t* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_u32_store_release(uint32_t* ptr, uint32_t value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static bool atomic_u32_cas(uint32_t* ptr, uint32_t expected, uint32_t desired) {
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static uint32_t atomic_u32_load_seq_cst(const uint32_t* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static uint32_t atomic_u32_fetch_add(uint32_t* ptr, uint32_t value) {
+  return __atomic_fetch_add(ptr, value, __ATOMIC_RELAXED);
+}
+
+static uint32_t atomic_u32_fetch_or(uint32_t* ptr, uint32_t value) {
+  return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static void* atomic_ptr_load_acquire(void* const* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static bool atomic_ptr_cas(void** ptr, void* expected, void* desired) {
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+static void default_parallel_for(void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count) {
+  for (uint32_t job_index = 0; job_index < job_count; ++job_index) {
+    job(context, job_index);
   }
 }
 
-static void hash_grow(hash_t* hash, uint32_t capacity_desired, void* allocator) {
-  const uint32_t capacity_pow2 = next_pow_2(capacity_desired);
-  const uint32_t capacity_new = capacity_pow2 < HASH_INITIAL_CAPACITY ? HASH_INITIAL_CAPACITY : capacity_pow2;
+// picks how many jobs to split *item_count* items into so each job has a worthwhile amount of work
+static uint32_t parallel_job_count(uint32_t item_count) {
+  const uint32_t job_count_max = item_count / PARALLEL_MIN_ITEMS_PER_JOB;
+  const uint32_t job_count = s_config.job_count < job_count_max ? s_config.job_count : job_count_max;
+  return job_count == 0 ? 1 : job_count;
+}
 
-  // alloc new key and value arrays
-  uint32_t* keys_new = (uint32_t*)s_config.alloc(capacity_new * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
-  uint32_t* values_new = (uint32_t*)s_config.alloc(capacity_new * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+// gets the first item index of the given job's share of *item_count* items
+static uint32_t parallel_job_begin(uint32_t item_count, uint32_t job_count, uint32_t job_index) {
+  return (uint32_t)(((uint64_t)item_count * job_index) / job_count);
+}
 
-  // mark all buckets as empty
-  memset(keys_new, 0, capacity_new * sizeof(uint32_t));
+//
+// profiling
+//
 
-  // swap out the hash data the new and old arrays
-  const uint32_t capacity_old = hash->capacity;
-  uint32_t* keys_old = hash->keys;
-  uint32_t* values_old = hash->values;
-  hash->keys = keys_new;
-  hash->values = values_new;
-  hash->count = 0;
-  hash->capacity = capacity_new;
+static const char* const PROFILE_OP_NAMES[CONTAINERS_PROFILE_OP_COUNT] = {"hash_insert", "hash_lookup", "hash_remove", "hash_grow", "array_grow"};
+static const char* const PROFILE_COUNTER_NAMES[CONTAINERS_PROFILE_COUNTER_COUNT] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"};
 
-  // reinsert the old elements
-  for (uint32_t index = 0; index < capacity_old; ++index) {
-    const uint32_t key_old = keys_old[index];
-    const uint32_t value_old = values_old[index];
-    if (key_old != 0) {
-      hash_insert_impl(hash, key_old, value_old);
+#ifdef CONTAINERS_PROFILE_PERF
+typedef struct profile_sample_t {
+  bool active;
+  uint64_t counters[CONTAINERS_PROFILE_COUNTER_COUNT];
+} profile_sample_t;
+
+static int s_profile_fds[CONTAINERS_PROFILE_COUNTER_COUNT] = {-1, -1, -1, -1, -1, -1};
+static struct perf_event_mmap_page* s_profile_pages[CONTAINERS_PROFILE_COUNTER_COUNT];
+static containers_profile_stats_t s_profile_stats[CONTAINERS_PROFILE_OP_COUNT];
+static __thread bool s_profile_thread;
+
+// the perf event type and config for each counter
+static const uint32_t PROFILE_EVENT_TYPES[CONTAINERS_PROFILE_COUNTER_COUNT] = {
+  PERF_TYPE_HARDWARE,
+  PERF_TYPE_HARDWARE,
+  PERF_TYPE_HW_CACHE,
+  PERF_TYPE_HARDWARE,
+  PERF_TYPE_HARDWARE,
+  PERF_TYPE_HW_CACHE,
+};
+static const uint64_t PROFILE_EVENT_CONFIGS[CONTAINERS_PROFILE_COUNTER_COUNT] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+  PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+};
+
+// Reads a counter through its mmap page with rdpmc, following the seqlock protocol documented in perf_event.h. Falls
+// back to a read syscall when user space reads are not allowed or the event is not currently on a hardware counter.
+static uint64_t profile_read_counter(uint32_t counter) {
+  if (s_profile_fds[counter] < 0) {
+    return 0;
+  }
+#ifdef CONTAINERS_X86
+  const struct perf_event_mmap_page* page = s_profile_pages[counter];
+  while (page != NULL) {
+    const uint32_t sequence = __atomic_load_n(&page->lock, __ATOMIC_ACQUIRE);
+    const uint32_t index = page->index;
+    if (!page->cap_user_rdpmc || index == 0) {
+      break;
+    }
+    const uint32_t shift = 64 - page->pmc_width;
+    const int64_t pmc = ((int64_t)__builtin_ia32_rdpmc((int)index - 1) << shift) >> shift;
+    const int64_t count = page->offset + pmc;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&page->lock, __ATOMIC_RELAXED) == sequence) {
+      return (uint64_t)count;
     }
   }
-
-  // cleanup
-  if (capacity_old > 0) {
-    s_config.free(keys_old, allocator, __FILE__, __LINE__, __func__);
-    s_config.free(values_old, allocator, __FILE__, __LINE__, __func__);
+#endif
+  uint64_t count = 0;
+  if (read(s_profile_fds[counter], &count, sizeof(count)) != sizeof(count)) {
+    return 0;
   }
+  return count;
 }
 
-void containers_lib_config_init(containers_lib_config_t* config) {
-  if (config == NULL) {
+static void profile_begin(profile_sample_t* sample) {
+  sample->active = s_profile_thread;
+  if (!sample->active) {
     return;
   }
-
-  config->alloc = &default_alloc;
-  config->free = &default_free;
-  config->assert_failed = &default_assert_failed;
+  for (uint32_t counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+    sample->counters[counter] = profile_read_counter(counter);
+  }
 }
 
-void containers_lib_init(const containers_lib_config_t* config) {
-  if (config == NULL) {
-    containers_lib_config_init(&s_config);
+static void profile_end(profile_sample_t* sample, containers_profile_op_t op) {
+  if (!sample->active) {
+    return;
   }
-  else {
-    s_config = *config;
+  containers_profile_stats_t* stats = &s_profile_stats[op];
+  for (uint32_t counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+    stats->counters[counter] += profile_read_counter(counter) - sample->counters[counter];
   }
+  ++stats->calls;
 }
 
-void containers_lib_shutdown() {
-  memset(&s_config, 0, sizeof(s_config));
-}
+#define PROFILE_BEGIN(op) \
+  profile_sample_t profile_sample; \
+  profile_begin(&profile_sample)
+#define PROFILE_END(op) profile_end(&profile_sample, op)
+#else
+#define PROFILE_BEGIN(op)
+#define PROFILE_END(op)
+#endif // CONTAINERS_PROFILE_PERF
 
-uint32_t hash_count(const hash_t* hash) {
-  return hash->count;
+// tests if the default aligned allocator has to carve blocks out of a replaced alloc so the allocator sees them
+static bool table_carves() {
+#ifdef CONTAINERS_ALLOC_ALIGNED_BOUND
+  return false;
+#else
+  return s_config.alloc_aligned == &default_alloc_aligned && !default_alloc_in_use();
+#endif
 }
 
-uint32_t hash_capacity(const hash_t* hash) {
-  return hash->capacity;
+// Allocates one of the cache line aligned flat arrays behind the hash tables and indexes (see
+// containers_lib_config_t.alloc_aligned). *table_class* gets how the block was allocated: its size class, or
+// TABLE_CLASS_CARVED. The owner keeps it next to the block and hands it back to table_free, so the block is freed the
+// way it was allocated even if containers_lib_init has changed the threshold or allocators since.
+static void* table_alloc(size_t size_bytes, uint8_t* table_class, void* allocator, const char* file, int line, const char* func) {
+  if (table_carves()) {
+    // over-allocate and keep the pointer alloc returned just before the aligned block
+    uint8_t* raw = (uint8_t*)CONTAINERS_ALLOC(size_bytes + CONTAINERS_CACHE_LINE_SIZE + sizeof(void*), allocator, file, line, func);
+    if (raw == NULL) {
+      return NULL;
+    }
+    uint8_t* aligned = (uint8_t*)round_up((uintptr_t)(raw + sizeof(void*)), CONTAINERS_CACHE_LINE_SIZE);
+    ((void**)aligned)[-1] = raw;
+    *table_class = TABLE_CLASS_CARVED;
+    return aligned;
+  }
+  const containers_size_class_t size_class = size_bytes >= s_config.large_alloc_threshold ? CONTAINERS_SIZE_CLASS_LARGE : CONTAINERS_SIZE_CLASS_SMALL;
+  *table_class = (uint8_t)size_class;
+  return CONTAINERS_ALLOC_ALIGNED(size_bytes, CONTAINERS_CACHE_LINE_SIZE, size_class, allocator, file, line, func);
 }
 
-void hash_free(hash_t* hash, void* allocator) {
-  if (hash->capacity > 0) {
-    s_config.free(hash->keys, allocator, __FILE__, __LINE__, __func__);
-    s_config.free(hash->values, allocator, __FILE__, __LINE__, __func__);
+static void table_free(void* ptr, size_t size_bytes, uint8_t table_class, void* allocator, const char* file, int line, const char* func) {
+  if (table_class == TABLE_CLASS_CARVED) {
+    CONTAINERS_FREE(((void**)ptr)[-1], allocator, file, line, func);
+    return;
   }
-  hash->keys = NULL;
-  hash->values = NULL;
-  hash->count = 0;
-  hash->capacity = 0;
+  CONTAINERS_FREE_ALIGNED(ptr, size_bytes, (containers_size_class_t)table_class, allocator, file, line, func);
 }
 
-void hash_insert(hash_t* hash, uint32_t key, uint32_t value, void* allocator) {
-  const uint32_t resize_threshold = (hash->capacity * HASH_LOAD_FACTOR_PERCENT) / 100;
-  if (hash->count >= resize_threshold) {
-    hash_grow(hash, hash->capacity + 1, allocator);
-  }
-  hash_insert_impl(hash, key, value);
+#define TABLE_ALLOC(size, table_class, allocator) table_alloc(size, table_class, allocator, __FILE__, __LINE__, __func__)
+#define TABLE_FREE(ptr, size, table_class, allocator) table_free(ptr, size, table_class, allocator, __FILE__, __LINE__, __func__)
+
+static uint32_t count_trailing_zeros_u64(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return (uint32_t)index;
+#else
+  return (uint32_t)__builtin_ctzll(value);
+#endif
 }
 
-uint32_t hash_lookup(const hash_t* hash, uint32_t key, uint32_t default_value) {
-  const uint32_t* keys = hash->keys;
-  const uint32_t* values = hash->values;
-  const uint32_t capacity = hash->capacity;
-  const uint32_t mask = capacity - 1;
+static uint32_t floor_log2_u32(uint32_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanReverse(&index, value);
+  return (uint32_t)index;
+#else
+  return 31 - (uint32_t)__builtin_clz(value);
+#endif
+}
 
-  // nothing to find in an empty table
-  if (capacity == 0) {
-    return default_value;
-  }
+static uint32_t next_pow_2(uint32_t value) {
+  --value;
+  value |= (value >> 1);
+  value |= (value >> 2);
+  value |= (value >> 4);
+  value |= (value >> 8);
+  value |= (value >> 16);
+  ++value;
+  value += (value == 0);
+  return value;
+}
 
-  uint32_t index = key & mask;
-  uint32_t distance = 0;
+// Places the key (and value, when there is a value array) into the table using robin hood placement, starting the probe
+// at *index* having already probed *distance* buckets. The key must not already be in the table.
+static void robin_hood_insert_from(uint32_t* keys, uint32_t* values, uint32_t capacity, uint32_t index, uint32_t distance, uint32_t key, uint32_t value) {
+  const uint32_t mask = (capacity - 1);
   for (;;) {
     const uint32_t key_cur = keys[index];
-
-    // found a match
-    if (key_cur == key) {
-      return values[index];
-    }
-
-    // found an empty slot; not found
+    // if the current index is empty, use it
     if (key_cur == 0) {
-      return default_value;
+      keys[index] = key;
+      if (values != NULL) {
+        values[index] = value;
+      }
+      break;
     }
 
-    // we've probed farther than the current slot's distance; implies not found
+    // if the existing element has probled less than us, swap places and look for a place for the existing element
     const uint32_t distance_existing = (index + capacity - (key_cur & mask)) & mask;
-    if (distance > distance_existing) {
-      return default_value;
+    if (distance_existing < distance) {
+      keys[index] = key;
+      key = key_cur;
+      if (values != NULL) {
+        const uint32_t tmp_value = values[index];
+        values[index] = value;
+        value = tmp_value;
+      }
+      distance = distance_existing;
     }
 
-    // probe the next slot
+    // linear probing
     index = (index + 1) & mask;
     ++distance;
   }
 }
 
-bool hash_contains(const hash_t* hash, uint32_t key) {
-  const uint32_t* keys = hash->keys;
-  const uint32_t capacity = hash->capacity;
-  const uint32_t mask = capacity - 1;
-
-  // nothing to find in an empty table
-  if (capacity == 0) {
-    return false;
-  }
+// Places the key (and value) into the table using robin hood placement. The key must not already be in the table.
+static void robin_hood_insert(uint32_t* keys, uint32_t* values, uint32_t capacity, uint32_t key, uint32_t value) {
+  robin_hood_insert_from(keys, values, capacity, key & (capacity - 1), 0, key, value);
+}
 
+// Finds the bucket holding the key, or places the key (and value) if it is missing, in a single probe sequence. Returns
+// the bucket the key ends up in. The table must have room for one more key.
+static uint32_t robin_hood_find_or_insert(uint32_t* keys, uint32_t* values, uint32_t capacity, uint32_t key, uint32_t value, bool* inserted) {
+  const uint32_t mask = capacity - 1;
   uint32_t index = key & mask;
   uint32_t distance = 0;
   for (;;) {
@@ -211,38 +559,47 @@ bool hash_contains(const hash_t* hash, uint32_t key) {
 
     // found a match
     if (key_cur == key) {
-      return true;
+      *inserted = false;
+      return index;
     }
 
-    // found an empty slot; not found
+    // found an empty slot; the key goes here
     if (key_cur == 0) {
-      return false;
+      keys[index] = key;
+      if (values != NULL) {
+        values[index] = value;
+      }
+      *inserted = true;
+      return index;
     }
 
-    // we've probed farther than the current slot's distance; implies not found
+    // we've probed farther than the current slot's distance so the key is not in the table; it takes this slot and the
+    // existing element continues the probe
     const uint32_t distance_existing = (index + capacity - (key_cur & mask)) & mask;
     if (distance > distance_existing) {
-      return false;
+      const uint32_t value_cur = (values != NULL) ? values[index] : 0;
+      keys[index] = key;
+      if (values != NULL) {
+        values[index] = value;
+      }
+      robin_hood_insert_from(keys, values, capacity, (index + 1) & mask, distance_existing + 1, key_cur, value_cur);
+      *inserted = true;
+      return index;
     }
 
     // probe the next slot
     index = (index + 1) & mask;
     ++distance;
   }
-
-  // if we got here, there was an error
-  return false;
 }
 
-void hash_remove(hash_t* hash, uint32_t key) {
-  uint32_t* keys = hash->keys;
-  uint32_t* values = hash->values;
-  const uint32_t capacity = hash->capacity;
+// Finds the bucket holding the key, or HASH_INDEX_NONE.
+static uint32_t robin_hood_find(const uint32_t* keys, uint32_t capacity, uint32_t key) {
   const uint32_t mask = capacity - 1;
 
-  // nothing to remove in an empty table
+  // nothing to find in an empty table
   if (capacity == 0) {
-    return;
+    return HASH_INDEX_NONE;
   }
 
   uint32_t index = key & mask;
@@ -252,26 +609,30 @@ void hash_remove(hash_t* hash, uint32_t key) {
 
     // found a match
     if (key_cur == key) {
-      break;
+      return index;
     }
 
     // found an empty slot; not found
     if (key_cur == 0) {
-      return;
+      return HASH_INDEX_NONE;
     }
 
     // we've probed farther than the current slot's distance; implies not found
     const uint32_t distance_existing = (index + capacity - (key_cur & mask)) & mask;
     if (distance > distance_existing) {
-      return;
+      return HASH_INDEX_NONE;
     }
 
     // probe the next slot
     index = (index + 1) & mask;
     ++distance;
   }
+}
 
-  // now backshift the remaining elements whole distance is greater than zero
+// Empties the given bucket and backshifts the elements after it that are not in their ideal bucket.
+static void robin_hood_remove_at(uint32_t* keys, uint32_t* values, uint32_t capacity, uint32_t index) {
+  const uint32_t mask = capacity - 1;
+  uint32_t index_dst = index;
   for (uint32_t offset = 1; offset < capacity; ++offset) {
     const uint32_t index_src = (index + offset) & mask;
     const uint32_t key_src = keys[index_src];
@@ -288,58 +649,3030 @@ void hash_remove(hash_t* hash, uint32_t key) {
     }
 
     // move the slot up
-    const uint32_t index_dst = (index + offset - 1) & mask;
-    keys[index_dst] = keys[index_src];
-    values[index_dst] = values[index_src];
+    keys[index_dst] = key_src;
+    if (values != NULL) {
+      values[index_dst] = values[index_src];
+    }
+    index_dst = index_src;
   }
+  keys[index_dst] = 0;
+}
 
-  --hash->count;
+// The filter is a split block Bloom filter: each key picks one 256-bit block (8 words, half a cache line) and sets one
+// bit in every word of it, so a query touches a single line and needs no data-dependent branching.
+static const uint32_t HASH_FILTER_SALTS[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+static uint32_t* hash_filter_block(const hash_t* hash, uint32_t key) {
+  const uint32_t mixed = key * 0x9e3779b1u;
+  const uint32_t block = (uint32_t)(((uint64_t)mixed * hash->filter_block_count) >> 32);
+  return hash->filter + (block * HASH_FILTER_WORDS_PER_BLOCK);
 }
 
-void hash_reserve(hash_t* hash, uint32_t capacity, void* allocator) {
-  if (capacity > hash->capacity) {
-    hash_grow(hash, capacity, allocator);
+static void hash_filter_add(hash_t* hash, uint32_t key) {
+  uint32_t* block = hash_filter_block(hash, key);
+  for (uint32_t word = 0; word < HASH_FILTER_WORDS_PER_BLOCK; ++word) {
+    block[word] |= 1u << ((key * HASH_FILTER_SALTS[word]) >> 27);
   }
 }
 
-void containers__array_free_impl(void* arr, void* allocator, const char* file, int line, const char* func) {
-  void* ptr = array__header(arr);
-  s_config.free(ptr, allocator, file, line, func);
+static bool hash_filter_test(const hash_t* hash, uint32_t key) {
+  const uint32_t* block = hash_filter_block(hash, key);
+  uint32_t missing = 0;
+  for (uint32_t word = 0; word < HASH_FILTER_WORDS_PER_BLOCK; ++word) {
+    const uint32_t bit = 1u << ((key * HASH_FILTER_SALTS[word]) >> 27);
+    missing |= bit & ~block[word];
+  }
+  return missing == 0;
 }
 
-void* containers__array_grow_impl(void* arr, uint32_t inc, uint32_t item_size, void* allocator, const char* file, int line, const char* func) {
-  // compute the new capacity
-  const uint32_t count_old = array_count(arr);
-  const uint32_t capacity_old = (arr == NULL) ? 0 : array__raw_capacity(arr);
-  const uint32_t capacity_required = count_old + inc;
-  const uint32_t capacity_doubled = 2 * capacity_old;
-  const uint32_t capacity_new = capacity_required > capacity_doubled ? capacity_required : capacity_doubled;
-
-  // realloc
-  array_header_t* ptr_new = (array_header_t*)s_config.alloc((capacity_new * item_size) + sizeof(array_header_t), allocator, file, line, func);
-  array_header_t* ptr_old = (arr == NULL) ? NULL : array__header(arr);
-  if (ptr_old != NULL) {
-    memmove(ptr_new, ptr_old, (count_old * item_size) + sizeof(array_header_t));
-    s_config.free(ptr_old, allocator, file, line, func);
+// (re)allocates the filter to suit the current capacity
+static void hash_filter_alloc(hash_t* hash, void* allocator) {
+  if (hash->filter != NULL) {
+    TABLE_FREE(hash->filter, (size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t), hash->filter_class, allocator);
   }
+  const uint64_t bits = ((uint64_t)hash->capacity * HASH_LOAD_FACTOR_PERCENT / 100) * hash->filter_bits_per_key;
+  const uint64_t block_count = bits / (HASH_FILTER_WORDS_PER_BLOCK * 32);
+  hash->filter_block_count = block_count == 0 ? 1 : (uint32_t)block_count;
+  hash->filter = (uint32_t*)TABLE_ALLOC((size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t), &hash->filter_class, allocator);
+}
+
+static void hash_filter_fill(hash_t* hash) {
+  memset(hash->filter, 0, (size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t));
+  for (uint32_t index = 0; index < hash->capacity; ++index) {
+    if (hash->keys[index] != 0) {
+      hash_filter_add(hash, hash->keys[index]);
+    }
+  }
+  hash->filter_stale = 0;
+}
+
+// removed keys stay set in the filter; rebuild once they make up a quarter of the keys so the false positive rate
+// stays close to the configured one
+static void hash_filter_note_removed(hash_t* hash) {
+  if (hash->filter != NULL && ++hash->filter_stale > (hash->count / 4) + 64) {
+    hash_filter_fill(hash);
+  }
+}
+
+static void hash_insert_impl(hash_t* hash, uint32_t key, uint32_t value) {
+  ++hash->count;
+  robin_hood_insert(hash->keys, hash->values, hash->capacity, key, value);
+  if (hash->filter != NULL) {
+    hash_filter_add(hash, key);
+  }
+}
+
+static void hash_grow(hash_t* hash, uint32_t capacity_desired, void* allocator) {
+  PROFILE_BEGIN(CONTAINERS_PROFILE_HASH_GROW);
+  const uint32_t capacity_pow2 = next_pow_2(capacity_desired);
+  const uint32_t capacity_new = capacity_pow2 < HASH_INITIAL_CAPACITY ? HASH_INITIAL_CAPACITY : capacity_pow2;
+
+  // alloc new key and value arrays
+  uint8_t keys_class_new;
+  uint32_t* keys_new = (uint32_t*)TABLE_ALLOC(capacity_new * sizeof(uint32_t), &keys_class_new, allocator);
+  uint32_t* values_new = (uint32_t*)TABLE_ALLOC(capacity_new * sizeof(uint32_t), &keys_class_new, allocator);
+
+  // mark all buckets as empty
+  memset(keys_new, 0, capacity_new * sizeof(uint32_t));
+
+  // swap out the hash data the new and old arrays
+  const uint32_t capacity_old = hash->capacity;
+  const uint8_t keys_class_old = hash->keys_class;
+  uint32_t* keys_old = hash->keys;
+  uint32_t* values_old = hash->values;
+  hash->keys = keys_new;
+  hash->values = values_new;
+  hash->keys_class = keys_class_new;
+  hash->count = 0;
+  hash->capacity = capacity_new;
+
+  // size a fresh filter for the new capacity; reinsertion fills it
+  if (hash->filter_bits_per_key != 0) {
+    hash_filter_alloc(hash, allocator);
+    memset(hash->filter, 0, (size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t));
+    hash->filter_stale = 0;
+  }
+
+  // reinsert the old elements
+  for (uint32_t index = 0; index < capacity_old; ++index) {
+    const uint32_t key_old = keys_old[index];
+    const uint32_t value_old = values_old[index];
+    if (key_old != 0) {
+      hash_insert_impl(hash, key_old, value_old);
+    }
+  }
+
+  // cleanup
+  if (capacity_old > 0) {
+    TABLE_FREE(keys_old, capacity_old * sizeof(uint32_t), keys_class_old, allocator);
+    TABLE_FREE(values_old, capacity_old * sizeof(uint32_t), keys_class_old, allocator);
+  }
+  PROFILE_END(CONTAINERS_PROFILE_HASH_GROW);
+}
+
+void containers_lib_config_init(containers_lib_config_t* config) {
+  if (config == NULL) {
+    return;
+  }
+
+  config->alloc = &default_alloc;
+  config->free = &default_free;
+  config->assert_failed = &default_assert_failed;
+  config->parallel_for = &default_parallel_for;
+  config->job_count = 1;
+  config->simd_level = CONTAINERS_SIMD_BEST;
+  config->alloc_aligned = &default_alloc_aligned;
+  config->free_aligned = &default_free_aligned;
+  config->large_alloc_threshold = HUGE_PAGE_SIZE;
+  config->numa_node = -1;
+}
+
+void containers_lib_init(const containers_lib_config_t* config) {
+  if (config == NULL) {
+    containers_lib_config_init(&s_config);
+  }
+  else {
+    s_config = *config;
+  }
+
+  simd_kernels_select(s_config.simd_level);
+}
+
+void containers_lib_shutdown() {
+  memset(&s_config, 0, sizeof(s_config));
+}
+
+containers_simd_t containers_lib_simd_level() {
+  return s_simd_level;
+}
+
+#ifdef CONTAINERS_PROFILE_PERF
+bool containers_profile_start() {
+  containers_profile_stop();
+  containers_profile_reset();
+  bool opened = false;
+  for (uint32_t counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PROFILE_EVENT_TYPES[counter];
+    attr.config = PROFILE_EVENT_CONFIGS[counter];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // each counter is opened on its own so one the pmu can't provide doesn't take the others down with it
+    s_profile_fds[counter] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (s_profile_fds[counter] < 0) {
+      continue;
+    }
+    void* page = mmap(NULL, (size_t)sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, s_profile_fds[counter], 0);
+    s_profile_pages[counter] = page == MAP_FAILED ? NULL : (struct perf_event_mmap_page*)page;
+    opened = true;
+  }
+  s_profile_thread = true;
+  return opened;
+}
+
+void containers_profile_stop() {
+  s_profile_thread = false;
+  for (uint32_t counter = 0; counter < CONTAINERS_PROFILE_COUNTER_COUNT; ++counter) {
+    if (s_profile_pages[counter] != NULL) {
+      munmap(s_profile_pages[counter], (size_t)sysconf(_SC_PAGESIZE));
+      s_profile_pages[counter] = NULL;
+    }
+    if (s_profile_fds[counter] >= 0) {
+      close(s_profile_fds[counter]);
+      s_profile_fds[counter] = -1;
+    }
+  }
+}
+
+void containers_profile_reset() {
+  memset(s_profile_stats, 0, sizeof(s_profile_stats));
+}
+
+bool containers_profile_counter_available(containers_profile_counter_t counter) {
+  return s_profile_fds[counter] >= 0;
+}
+
+void containers_profile_read(containers_profile_op_t op, containers_profile_stats_t* stats) {
+  *stats = s_profile_stats[op];
+}
+#else
+bool containers_profile_start() {
+  return false;
+}
+
+void containers_profile_stop() {
+}
+
+void containers_profile_reset() {
+}
+
+bool containers_profile_counter_available(containers_profile_counter_t counter) {
+  return false;
+}
+
+void containers_profile_read(containers_profile_op_t op, containers_profile_stats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+#endif // CONTAINERS_PROFILE_PERF
+
+const char* containers_profile_op_name(containers_profile_op_t op) {
+  return PROFILE_OP_NAMES[op];
+}
+
+const char* containers_profile_counter_name(containers_profile_counter_t counter) {
+  return PROFILE_COUNTER_NAMES[counter];
+}
+
+uint32_t hash_count(const hash_t* hash) {
+  return hash->count;
+}
+
+uint32_t hash_capacity(const hash_t* hash) {
+  return hash->capacity;
+}
+
+void hash_free(hash_t* hash, void* allocator) {
+  if (hash->capacity > 0) {
+    TABLE_FREE(hash->keys, hash->capacity * sizeof(uint32_t), hash->keys_class, allocator);
+    TABLE_FREE(hash->values, hash->capacity * sizeof(uint32_t), hash->keys_class, allocator);
+  }
+  if (hash->filter != NULL) {
+    TABLE_FREE(hash->filter, (size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t), hash->filter_class, allocator);
+  }
+  memset(hash, 0, sizeof(*hash));
+}
+
+void hash_insert(hash_t* hash, uint32_t key, uint32_t value, void* allocator) {
+  PROFILE_BEGIN(CONTAINERS_PROFILE_HASH_INSERT);
+  const uint32_t resize_threshold = (uint32_t)(((uint64_t)hash->capacity * HASH_LOAD_FACTOR_PERCENT) / 100);
+  if (hash->count >= resize_threshold) {
+    hash_grow(hash, hash->capacity + 1, allocator);
+  }
+  hash_insert_impl(hash, key, value);
+  PROFILE_END(CONTAINERS_PROFILE_HASH_INSERT);
+}
+
+void hash_upsert(hash_t* hash, uint32_t key, uint32_t value, void* allocator) {
+  bool inserted;
+  *hash_find_or_insert(hash, key, value, &inserted, allocator) = value;
+}
+
+uint32_t* hash_find_or_insert(hash_t* hash, uint32_t key, uint32_t value, bool* inserted, void* allocator) {
+  const uint32_t resize_threshold = (uint32_t)(((uint64_t)hash->capacity * HASH_LOAD_FACTOR_PERCENT) / 100);
+  if (hash->count >= resize_threshold) {
+    // only grow a full table when the key is actually new; updates of existing keys leave it alone
+    if (hash->capacity > 0) {
+      const uint32_t index = robin_hood_find(hash->keys, hash->capacity, key);
+      if (index != HASH_INDEX_NONE) {
+        *inserted = false;
+        return &hash->values[index];
+      }
+    }
+    hash_grow(hash, hash->capacity + 1, allocator);
+  }
+  const uint32_t index = robin_hood_find_or_insert(hash->keys, hash->values, hash->capacity, key, value, inserted);
+  if (*inserted) {
+    ++hash->count;
+    if (hash->filter != NULL) {
+      hash_filter_add(hash, key);
+    }
+  }
+  return &hash->values[index];
+}
+
+uint32_t hash_lookup(const hash_t* hash, uint32_t key, uint32_t default_value) {
+  PROFILE_BEGIN(CONTAINERS_PROFILE_HASH_LOOKUP);
+  uint32_t value = default_value;
+  if (hash->filter == NULL || hash_filter_test(hash, key)) {
+    const uint32_t index = robin_hood_find(hash->keys, hash->capacity, key);
+    value = index == HASH_INDEX_NONE ? default_value : hash->values[index];
+  }
+  PROFILE_END(CONTAINERS_PROFILE_HASH_LOOKUP);
+  return value;
+}
+
+bool hash_contains(const hash_t* hash, uint32_t key) {
+  if (hash->filter != NULL && !hash_filter_test(hash, key)) {
+    return false;
+  }
+  return robin_hood_find(hash->keys, hash->capacity, key) != HASH_INDEX_NONE;
+}
+
+void hash_remove(hash_t* hash, uint32_t key) {
+  PROFILE_BEGIN(CONTAINERS_PROFILE_HASH_REMOVE);
+  const uint32_t index = robin_hood_find(hash->keys, hash->capacity, key);
+  if (index != HASH_INDEX_NONE) {
+    robin_hood_remove_at(hash->keys, hash->values, hash->capacity, index);
+    --hash->count;
+    hash_filter_note_removed(hash);
+  }
+  PROFILE_END(CONTAINERS_PROFILE_HASH_REMOVE);
+}
+
+void hash_reserve(hash_t* hash, uint32_t capacity, void* allocator) {
+  if (capacity > hash->capacity) {
+    hash_grow(hash, capacity, allocator);
+  }
+}
+
+void hash_filter_enable(hash_t* hash, uint32_t bits_per_key, void* allocator) {
+  hash_filter_disable(hash, allocator);
+  hash->filter_bits_per_key = bits_per_key == 0 ? HASH_FILTER_DEFAULT_BITS_PER_KEY : bits_per_key;
+  if (hash->capacity > 0) {
+    hash_filter_alloc(hash, allocator);
+    hash_filter_fill(hash);
+  }
+}
+
+void hash_filter_disable(hash_t* hash, void* allocator) {
+  if (hash->filter != NULL) {
+    TABLE_FREE(hash->filter, (size_t)hash->filter_block_count * HASH_FILTER_WORDS_PER_BLOCK * sizeof(uint32_t), hash->filter_class, allocator);
+  }
+  hash->filter = NULL;
+  hash->filter_block_count = 0;
+  hash->filter_bits_per_key = 0;
+  hash->filter_stale = 0;
+}
+
+void hash_filter_rebuild(hash_t* hash) {
+  if (hash->filter != NULL) {
+    hash_filter_fill(hash);
+  }
+}
+
+void hash_iter_init(const hash_t* hash, hash_iter_t* iter, uint32_t chunk_index, uint32_t chunk_count) {
+  const uint32_t capacity = hash->capacity;
+  const uint32_t mask = capacity - 1;
+
+  // start at a bucket that is empty or holds a key in its ideal bucket. No probe sequence (and so no backshift) crosses
+  // such a bucket, which is what makes removing during iteration visit everything exactly once.
+  uint32_t origin = 0;
+  while (origin < capacity && hash->keys[origin] != 0 && (hash->keys[origin] & mask) != origin) {
+    ++origin;
+  }
+
+  iter->key = 0;
+  iter->value = 0;
+  iter->index = HASH_INDEX_NONE;
+  iter->origin = origin;
+  iter->position = parallel_job_begin(capacity, chunk_count, chunk_index);
+  iter->end = parallel_job_begin(capacity, chunk_count, chunk_index + 1);
+}
+
+bool hash_iter_next(const hash_t* hash, hash_iter_t* iter) {
+  const uint32_t capacity = hash->capacity;
+  while (iter->position < iter->end) {
+    // scan up to the end of the chunk or the end of the bucket array, whichever comes first
+    const uint32_t bucket = (iter->origin + iter->position) & (capacity - 1);
+    const uint32_t chunk_left = iter->end - iter->position;
+    const uint32_t run = (capacity - bucket) < chunk_left ? (capacity - bucket) : chunk_left;
+    const uint32_t found = s_kernels->find_not_u32(hash->keys + bucket, run, 0);
+    if (found != ARRAY_INDEX_NONE) {
+      iter->index = bucket + found;
+      iter->key = hash->keys[iter->index];
+      iter->value = hash->values[iter->index];
+      iter->position += found + 1;
+      return true;
+    }
+    iter->position += run;
+  }
+  return false;
+}
+
+void hash_iter_remove(hash_t* hash, hash_iter_t* iter) {
+  robin_hood_remove_at(hash->keys, hash->values, hash->capacity, iter->index);
+  --hash->count;
+  hash_filter_note_removed(hash);
+  // the backshift may have moved the next key into this bucket, so look at it again
+  --iter->position;
+}
+
+static void hash_set_grow(hash_set_t* set, uint32_t capacity_desired, void* allocator) {
+  const uint32_t capacity_pow2 = next_pow_2(capacity_desired);
+  const uint32_t capacity_new = capacity_pow2 < HASH_INITIAL_CAPACITY ? HASH_INITIAL_CAPACITY : capacity_pow2;
+
+  // alloc and clear the new key array
+  uint8_t keys_class_new;
+  uint32_t* keys_new = (uint32_t*)TABLE_ALLOC(capacity_new * sizeof(uint32_t), &keys_class_new, allocator);
+  memset(keys_new, 0, capacity_new * sizeof(uint32_t));
+
+  // reinsert the old elements
+  const uint32_t capacity_old = set->capacity;
+  const uint8_t keys_class_old = set->keys_class;
+  uint32_t* keys_old = set->keys;
+  for (uint32_t index = 0; index < capacity_old; ++index) {
+    if (keys_old[index] != 0) {
+      robin_hood_insert(keys_new, NULL, capacity_new, keys_old[index], 0);
+    }
+  }
+  set->keys = keys_new;
+  set->keys_class = keys_class_new;
+  set->capacity = capacity_new;
+
+  // cleanup
+  if (capacity_old > 0) {
+    TABLE_FREE(keys_old, capacity_old * sizeof(uint32_t), keys_class_old, allocator);
+  }
+}
+
+uint32_t hash_set_count(const hash_set_t* set) {
+  return set->count;
+}
+
+uint32_t hash_set_capacity(const hash_set_t* set) {
+  return set->capacity;
+}
+
+void hash_set_free(hash_set_t* set, void* allocator) {
+  if (set->capacity > 0) {
+    TABLE_FREE(set->keys, set->capacity * sizeof(uint32_t), set->keys_class, allocator);
+  }
+  set->keys = NULL;
+  set->count = 0;
+  set->capacity = 0;
+}
+
+bool hash_set_insert(hash_set_t* set, uint32_t key, void* allocator) {
+  const uint32_t resize_threshold = (uint32_t)(((uint64_t)set->capacity * HASH_LOAD_FACTOR_PERCENT) / 100);
+  if (set->count >= resize_threshold) {
+    if (set->capacity > 0 && robin_hood_find(set->keys, set->capacity, key) != HASH_INDEX_NONE) {
+      return false;
+    }
+    hash_set_grow(set, set->capacity + 1, allocator);
+  }
+  bool inserted;
+  robin_hood_find_or_insert(set->keys, NULL, set->capacity, key, 0, &inserted);
+  set->count += inserted ? 1 : 0;
+  return inserted;
+}
+
+bool hash_set_contains(const hash_set_t* set, uint32_t key) {
+  return robin_hood_find(set->keys, set->capacity, key) != HASH_INDEX_NONE;
+}
+
+bool hash_set_remove(hash_set_t* set, uint32_t key) {
+  const uint32_t index = robin_hood_find(set->keys, set->capacity, key);
+  if (index == HASH_INDEX_NONE) {
+    return false;
+  }
+  robin_hood_remove_at(set->keys, NULL, set->capacity, index);
+  --set->count;
+  return true;
+}
+
+void hash_set_reserve(hash_set_t* set, uint32_t capacity, void* allocator) {
+  if (capacity > set->capacity) {
+    hash_set_grow(set, capacity, allocator);
+  }
+}
+
+static size_t hash_small_key_bytes(const hash_small_t* hash) {
+  return hash->fingerprints ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+static size_t hash_small_bytes(const hash_small_t* hash, uint32_t capacity) {
+  return (size_t)capacity * (hash_small_key_bytes(hash) + sizeof(uint16_t));
+}
+
+// the values follow the keys in the same block
+static uint16_t* hash_small_values(const hash_small_t* hash) {
+  return (uint16_t*)((uint8_t*)hash->keys + ((size_t)hash->capacity * hash_small_key_bytes(hash)));
+}
+
+static uint32_t hash_small_key_at(const hash_small_t* hash, uint32_t index) {
+  return hash->fingerprints ? ((const uint16_t*)hash->keys)[index] : ((const uint32_t*)hash->keys)[index];
+}
+
+static void hash_small_set_key(hash_small_t* hash, uint32_t index, uint32_t key) {
+  if (hash->fingerprints) {
+    ((uint16_t*)hash->keys)[index] = (uint16_t)key;
+  }
+  else {
+    ((uint32_t*)hash->keys)[index] = key;
+  }
+}
+
+// the key as stored: fingerprints keep the low 16 bits, with 0 moved to 1 because 0 marks an empty bucket
+static uint32_t hash_small_stored_key(const hash_small_t* hash, uint32_t key) {
+  if (hash->fingerprints) {
+    key &= 0xffff;
+    key += (key == 0);
+  }
+  return key;
+}
+
+// the same robin hood placement as robin_hood_insert_from, over the narrower arrays
+static void hash_small_insert_from(hash_small_t* hash, uint32_t index, uint32_t distance, uint32_t key, uint16_t value) {
+  const uint32_t capacity = hash->capacity;
+  const uint32_t mask = capacity - 1;
+  uint16_t* values = hash_small_values(hash);
+  for (;;) {
+    const uint32_t key_cur = hash_small_key_at(hash, index);
+    if (key_cur == 0) {
+      hash_small_set_key(hash, index, key);
+      values[index] = value;
+      return;
+    }
+
+    // take the bucket from an element that has probed less than us and carry it on instead
+    const uint32_t distance_existing = (index + capacity - (key_cur & mask)) & mask;
+    if (distance_existing < distance) {
+      const uint16_t value_cur = values[index];
+      hash_small_set_key(hash, index, key);
+      values[index] = value;
+      key = key_cur;
+      value = value_cur;
+      distance = distance_existing;
+    }
+
+    index = (index + 1) & mask;
+    ++distance;
+  }
+}
+
+static void hash_small_grow(hash_small_t* hash, uint32_t capacity_desired, void* allocator) {
+  const uint32_t capacity_pow2 = next_pow_2(capacity_desired);
+  const uint32_t capacity_new = capacity_pow2 < HASH_SMALL_INITIAL_CAPACITY ? HASH_SMALL_INITIAL_CAPACITY : capacity_pow2;
+
+#ifdef CONTAINERS_CHECK_ENABLED
+  if (capacity_new > HASH_SMALL_MAX_CAPACITY) {
+    CONTAINERS_ASSERT_FAILED("capacity_new <= HASH_SMALL_MAX_CAPACITY", "a small hash holds at most HASH_SMALL_MAX_COUNT entries", __FILE__, __LINE__, __func__);
+  }
+#endif
+
+  // the keys and values share one cache line aligned block, so a 16 bucket table with fingerprints is a single line
+  const hash_small_t old = *hash;
+  const uint16_t* values_old = old.capacity > 0 ? hash_small_values(&old) : NULL;
+  hash->keys = TABLE_ALLOC(hash_small_bytes(hash, capacity_new), &hash->keys_class, allocator);
+  hash->capacity = capacity_new;
+  memset(hash->keys, 0, (size_t)capacity_new * hash_small_key_bytes(hash));
+
+  // reinsert the old elements; with fingerprints the stored bits are enough to find the new home bucket because the
+  // table never has more than 2^16 buckets
+  for (uint32_t index = 0; index < old.capacity; ++index) {
+    const uint32_t key = hash_small_key_at(&old, index);
+    if (key != 0) {
+      hash_small_insert_from(hash, key & (capacity_new - 1), 0, key, values_old[index]);
+    }
+  }
+
+  if (old.capacity > 0) {
+    TABLE_FREE(old.keys, hash_small_bytes(&old, old.capacity), old.keys_class, allocator);
+  }
+}
+
+void hash_small_init(hash_small_t* hash, bool fingerprints) {
+  memset(hash, 0, sizeof(*hash));
+  hash->fingerprints = fingerprints;
+}
+
+void hash_small_free(hash_small_t* hash, void* allocator) {
+  if (hash->capacity > 0) {
+    TABLE_FREE(hash->keys, hash_small_bytes(hash, hash->capacity), hash->keys_class, allocator);
+  }
+  hash_small_init(hash, hash->fingerprints);
+}
+
+uint32_t hash_small_count(const hash_small_t* hash) {
+  return hash->count;
+}
+
+uint32_t hash_small_capacity(const hash_small_t* hash) {
+  return hash->capacity;
+}
+
+size_t hash_small_size_bytes(const hash_small_t* hash) {
+  return hash_small_bytes(hash, hash->capacity);
+}
+
+void hash_small_insert(hash_small_t* hash, uint32_t key, uint16_t value, void* allocator) {
+  const uint32_t resize_threshold = (hash->capacity * HASH_LOAD_FACTOR_PERCENT) / 100;
+  if (hash->count >= resize_threshold) {
+    hash_small_grow(hash, hash->capacity + 1, allocator);
+  }
+  key = hash_small_stored_key(hash, key);
+  hash_small_insert_from(hash, key & (hash->capacity - 1), 0, key, value);
+  ++hash->count;
+}
+
+// Probes for the stored key from *distance* along its sequence and returns the bucket, or HASH_INDEX_NONE. There is a
+// copy per key width so the probe loop reads the keys directly instead of branching on the mode for every bucket.
+static uint32_t hash_small_probe_u32(const uint32_t* keys, uint32_t capacity, uint32_t key, uint32_t distance) {
+  const uint32_t mask = capacity - 1;
+  for (; distance < capacity; ++distance) {
+    const uint32_t index = (key + distance) & mask;
+    const uint32_t key_cur = keys[index];
+    if (key_cur == key) {
+      return index;
+    }
+
+    // an empty bucket, or an element closer to home than we are, ends the run
+    if (key_cur == 0 || distance > ((index + capacity - (key_cur & mask)) & mask)) {
+      break;
+    }
+  }
+  return HASH_INDEX_NONE;
+}
+
+static uint32_t hash_small_probe_u16(const uint16_t* keys, uint32_t capacity, uint32_t key, uint32_t distance) {
+  const uint32_t mask = capacity - 1;
+  for (; distance < capacity; ++distance) {
+    const uint32_t index = (key + distance) & mask;
+    const uint32_t key_cur = keys[index];
+    if (key_cur == key) {
+      return index;
+    }
+    if (key_cur == 0 || distance > ((index + capacity - (key_cur & mask)) & mask)) {
+      break;
+    }
+  }
+  return HASH_INDEX_NONE;
+}
+
+// Sets bit i of the result when bucket i holds the key. The capacity is a power of 2 of at least 8, so the 16-byte
+// compares cover the table exactly.
+static uint64_t hash_small_match_u32(const uint32_t* keys, uint32_t capacity, uint32_t key) {
+  uint64_t matches = 0;
+#ifdef CONTAINERS_X86
+  const __m128i needle = _mm_set1_epi32((int)key);
+  for (uint32_t index = 0; index < capacity; index += 4) {
+    const __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(keys + index)), needle);
+    matches |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(equal)) << index;
+  }
+#else
+  for (uint32_t index = 0; index < capacity; ++index) {
+    matches |= (uint64_t)(keys[index] == key) << index;
+  }
+#endif
+  return matches;
+}
+
+static uint64_t hash_small_match_u16(const uint16_t* keys, uint32_t capacity, uint32_t key) {
+  uint64_t matches = 0;
+#ifdef CONTAINERS_X86
+  const __m128i needle = _mm_set1_epi16((short)key);
+  for (uint32_t index = 0; index < capacity; index += 8) {
+    const __m128i equal = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(keys + index)), needle);
+    matches |= (uint64_t)_mm_movemask_epi8(_mm_packs_epi16(equal, _mm_setzero_si128())) << index;
+  }
+#else
+  for (uint32_t index = 0; index < capacity; ++index) {
+    matches |= (uint64_t)(keys[index] == key) << index;
+  }
+#endif
+  return matches;
+}
+
+uint32_t hash_small_find_next(const hash_small_t* hash, uint32_t key, uint32_t* cursor) {
+  if (hash->capacity == 0) {
+    return HASH_SMALL_NONE;
+  }
+
+  // *cursor* is how far along the key's probe sequence the previous call stopped
+  key = hash_small_stored_key(hash, key);
+  const uint32_t capacity = hash->capacity;
+  if (capacity <= HASH_SMALL_SCAN_CAPACITY) {
+    // tables this small are compared whole, which avoids the mispredicted loop exits of a short probe; every bucket
+    // holding the key is a match, so the matches only need ordering by distance from the home bucket
+    const uint64_t matches = hash->fingerprints ? hash_small_match_u16((const uint16_t*)hash->keys, capacity, key) : hash_small_match_u32((const uint32_t*)hash->keys, capacity, key);
+    const uint32_t home = key & (capacity - 1);
+    const uint64_t by_distance = ((matches >> home) | (matches << (capacity - home))) & (((uint64_t)1 << capacity) - 1) & ~(((uint64_t)1 << *cursor) - 1);
+    if (by_distance == 0) {
+      *cursor = capacity;
+      return HASH_SMALL_NONE;
+    }
+    const uint32_t distance = count_trailing_zeros_u64(by_distance);
+    *cursor = distance + 1;
+    return hash_small_values(hash)[(home + distance) & (capacity - 1)];
+  }
+
+  const uint32_t index = hash->fingerprints ? hash_small_probe_u16((const uint16_t*)hash->keys, hash->capacity, key, *cursor) : hash_small_probe_u32((const uint32_t*)hash->keys, hash->capacity, key, *cursor);
+  if (index == HASH_INDEX_NONE) {
+    *cursor = hash->capacity;
+    return HASH_SMALL_NONE;
+  }
+  *cursor = ((index + hash->capacity - (key & (hash->capacity - 1))) & (hash->capacity - 1)) + 1;
+  return hash_small_values(hash)[index];
+}
+
+uint32_t hash_small_lookup(const hash_small_t* hash, uint32_t key, uint32_t default_value) {
+  // keys are unique, so a whole-table compare can take the first match without ordering by distance; this keeps the
+  // common case short enough for many lookups to be in flight at once when the tables miss the cache
+  const uint32_t capacity = hash->capacity;
+  if (capacity - 1 < HASH_SMALL_SCAN_CAPACITY) {
+    key = hash_small_stored_key(hash, key);
+    const uint64_t matches = hash->fingerprints ? hash_small_match_u16((const uint16_t*)hash->keys, capacity, key) : hash_small_match_u32((const uint32_t*)hash->keys, capacity, key);
+    return matches == 0 ? default_value : hash_small_values(hash)[count_trailing_zeros_u64(matches)];
+  }
+
+  uint32_t cursor = 0;
+  const uint32_t value = hash_small_find_next(hash, key, &cursor);
+  return value == HASH_SMALL_NONE ? default_value : value;
+}
+
+bool hash_small_contains(const hash_small_t* hash, uint32_t key) {
+  return hash_small_lookup(hash, key, HASH_SMALL_NONE) != HASH_SMALL_NONE;
+}
+
+bool hash_small_remove(hash_small_t* hash, uint32_t key, uint16_t value) {
+  uint32_t cursor = 0;
+  for (uint32_t found = hash_small_find_next(hash, key, &cursor); found != HASH_SMALL_NONE; found = hash_small_find_next(hash, key, &cursor)) {
+    if (found != value) {
+      continue;
+    }
+
+    // empty the bucket and backshift the elements after it that are not in their home bucket
+    const uint32_t mask = hash->capacity - 1;
+    uint16_t* values = hash_small_values(hash);
+    uint32_t index_dst = (hash_small_stored_key(hash, key) + cursor - 1) & mask;
+    for (uint32_t offset = 1; offset < hash->capacity; ++offset) {
+      const uint32_t index_src = (index_dst + 1) & mask;
+      const uint32_t key_src = hash_small_key_at(hash, index_src);
+      if (key_src == 0 || ((index_src + hash->capacity - (key_src & mask)) & mask) == 0) {
+        break;
+      }
+      hash_small_set_key(hash, index_dst, key_src);
+      values[index_dst] = values[index_src];
+      index_dst = index_src;
+    }
+    hash_small_set_key(hash, index_dst, 0);
+    --hash->count;
+    return true;
+  }
+  return false;
+}
+
+void hash_small_reserve(hash_small_t* hash, uint32_t capacity, void* allocator) {
+  if (capacity > hash->capacity) {
+    hash_small_grow(hash, capacity, allocator);
+  }
+}
+
+// murmur3's finalizer; the frozen hash needs well mixed bits because it maps keys to buckets by multiplication
+static uint32_t hash_frozen_mix(uint32_t key, uint32_t seed) {
+  uint32_t mixed = key ^ seed;
+  mixed ^= mixed >> 16;
+  mixed *= 0x85ebca6bu;
+  mixed ^= mixed >> 13;
+  mixed *= 0xc2b2ae35u;
+  mixed ^= mixed >> 16;
+  return mixed;
+}
+
+// the two candidate buckets come from the high and low halves of the mixed key, each mapped onto the bucket count
+static void hash_frozen_candidates(uint32_t key, uint32_t seed, uint32_t bucket_count, uint32_t* first, uint32_t* second) {
+  const uint32_t mixed = hash_frozen_mix(key, seed);
+  *first = (uint32_t)(((uint64_t)mixed * bucket_count) >> 32);
+  *second = (uint32_t)(((uint64_t)((mixed << 16) | (mixed >> 16)) * bucket_count) >> 32);
+}
+
+static bool hash_frozen_try_place(uint32_t* bucket, uint32_t key, uint32_t value) {
+  for (uint32_t slot = 0; slot < HASH_FROZEN_SLOTS; ++slot) {
+    if (bucket[slot] == 0) {
+      bucket[slot] = key;
+      bucket[HASH_FROZEN_SLOTS + slot] = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Places the key with a random walk cuckoo insertion: when both candidate buckets are full, a random resident is
+// evicted and placed in turn. Returns false if the walk gives up, in which case an evicted key has been dropped and the
+// table must be rebuilt.
+static bool hash_frozen_place(hash_frozen_t* frozen, uint32_t key, uint32_t value, uint64_t* random) {
+  for (uint32_t kick = 0; kick < HASH_FROZEN_MAX_KICKS; ++kick) {
+    uint32_t first, second;
+    hash_frozen_candidates(key, frozen->seed, frozen->bucket_count, &first, &second);
+    uint32_t* bucket_first = frozen->buckets + (size_t)first * HASH_FROZEN_BUCKET_WORDS;
+    uint32_t* bucket_second = frozen->buckets + (size_t)second * HASH_FROZEN_BUCKET_WORDS;
+    if (hash_frozen_try_place(bucket_first, key, value) || hash_frozen_try_place(bucket_second, key, value)) {
+      return true;
+    }
+
+    // xorshift is plenty to break eviction cycles
+    *random ^= *random << 13;
+    *random ^= *random >> 7;
+    *random ^= *random << 17;
+    uint32_t* bucket = (*random & 1) ? bucket_first : bucket_second;
+    const uint32_t slot = (uint32_t)(*random >> 1) % HASH_FROZEN_SLOTS;
+    const uint32_t key_evicted = bucket[slot];
+    const uint32_t value_evicted = bucket[HASH_FROZEN_SLOTS + slot];
+    bucket[slot] = key;
+    bucket[HASH_FROZEN_SLOTS + slot] = value;
+    key = key_evicted;
+    value = value_evicted;
+  }
+  return false;
+}
+
+// allocates cleared, cache line aligned buckets
+static void hash_frozen_alloc(hash_frozen_t* frozen, uint32_t bucket_count, void* allocator) {
+  const size_t size_bytes = (size_t)bucket_count * HASH_FROZEN_BUCKET_WORDS * sizeof(uint32_t);
+  frozen->buckets = (uint32_t*)TABLE_ALLOC(size_bytes, &frozen->buckets_class, allocator);
+  frozen->bucket_count = bucket_count;
+  memset(frozen->buckets, 0, size_bytes);
+}
+
+void hash_freeze(const hash_t* hash, hash_frozen_t* frozen, void* allocator) {
+  memset(frozen, 0, sizeof(*frozen));
+  frozen->count = hash->count;
+  if (hash->count == 0) {
+    return;
+  }
+
+  const uint64_t slots_desired = ((uint64_t)hash->count * 100 + HASH_FROZEN_LOAD_FACTOR_PERCENT - 1) / HASH_FROZEN_LOAD_FACTOR_PERCENT;
+  uint32_t bucket_count = (uint32_t)((slots_desired + HASH_FROZEN_SLOTS - 1) / HASH_FROZEN_SLOTS);
+  uint64_t random = 0x9e3779b97f4a7c15ull;
+  for (uint32_t attempt = 0;; ++attempt) {
+    hash_frozen_alloc(frozen, bucket_count, allocator);
+    frozen->seed = attempt * 0x9e3779b9u;
+
+    bool placed = true;
+    for (uint32_t index = 0; index < hash->capacity && placed; ++index) {
+      if (hash->keys[index] != 0) {
+        placed = hash_frozen_place(frozen, hash->keys[index], hash->values[index], &random);
+      }
+    }
+    if (placed) {
+      return;
+    }
+
+    // stuck; start again with a new seed and a little more room
+    TABLE_FREE(frozen->buckets, hash_frozen_size_bytes(frozen), frozen->buckets_class, allocator);
+    bucket_count += bucket_count / 32 + 1;
+  }
+}
+
+void hash_frozen_free(hash_frozen_t* frozen, void* allocator) {
+  if (frozen->buckets != NULL) {
+    TABLE_FREE(frozen->buckets, hash_frozen_size_bytes(frozen), frozen->buckets_class, allocator);
+  }
+  memset(frozen, 0, sizeof(*frozen));
+}
+
+uint32_t hash_frozen_count(const hash_frozen_t* frozen) {
+  return frozen->count;
+}
+
+size_t hash_frozen_size_bytes(const hash_frozen_t* frozen) {
+  return (size_t)frozen->bucket_count * HASH_FROZEN_BUCKET_WORDS * sizeof(uint32_t);
+}
+
+// finds the slot holding the key (its value is HASH_FROZEN_SLOTS words further on), or NULL
+static const uint32_t* hash_frozen_find(const hash_frozen_t* frozen, uint32_t key) {
+  if (frozen->bucket_count == 0) {
+    return NULL;
+  }
+  uint32_t first, second;
+  hash_frozen_candidates(key, frozen->seed, frozen->bucket_count, &first, &second);
+  const uint32_t* bucket = frozen->buckets + (size_t)first * HASH_FROZEN_BUCKET_WORDS;
+  for (uint32_t slot = 0; slot < HASH_FROZEN_SLOTS; ++slot) {
+    if (bucket[slot] == key) {
+      return bucket + slot;
+    }
+  }
+  bucket = frozen->buckets + (size_t)second * HASH_FROZEN_BUCKET_WORDS;
+  for (uint32_t slot = 0; slot < HASH_FROZEN_SLOTS; ++slot) {
+    if (bucket[slot] == key) {
+      return bucket + slot;
+    }
+  }
+  return NULL;
+}
+
+uint32_t hash_frozen_lookup(const hash_frozen_t* frozen, uint32_t key, uint32_t default_value) {
+  const uint32_t* slot = hash_frozen_find(frozen, key);
+  return slot == NULL ? default_value : slot[HASH_FROZEN_SLOTS];
+}
+
+bool hash_frozen_contains(const hash_frozen_t* frozen, uint32_t key) {
+  return hash_frozen_find(frozen, key) != NULL;
+}
+
+// one input of a join and its radix partitioned copy
+typedef struct join_side_t {
+  const uint32_t* keys;
+  uint32_t count;
+  uint32_t job_count;
+  uint32_t* histograms; // partition_count counts per job; turned into scatter offsets in place
+  uint32_t* keys_partitioned;
+  uint32_t* indices_partitioned; // the input index of each partitioned key
+  uint8_t keys_partitioned_class;
+  uint8_t indices_partitioned_class;
+  uint32_t* starts; // partition_count + 1 offsets into the partitioned arrays
+} join_side_t;
+
+typedef struct join_t {
+  join_side_t sides[2]; // build, probe
+  uint32_t radix_bits;
+  uint32_t partition_count;
+  uint32_t side;
+  uint32_t job_count;
+
+  // every job has one chained table that it rebuilds for each of its partitions, so the table stays in cache: the
+  // chain heads, and the next build key in each chain (both relative to the partition start)
+  uint32_t* heads;
+  uint32_t* chains;
+  uint32_t heads_per_job;
+  uint32_t chains_per_job;
+  uint8_t heads_class;
+  uint8_t chains_class;
+
+  // matches per partition, then where each partition's pairs start in the outputs
+  uint64_t* match_starts;
+  uint32_t* build_out;
+  uint32_t* probe_out;
+} join_t;
+
+// Fibonacci hashing; only the top bits are well mixed, so the top *radix_bits* pick the partition and the bits below
+// them the bucket within it
+static uint32_t join_hash(uint32_t key) {
+  return key * 0x9e3779b1u;
+}
+
+static uint32_t join_partition(const join_t* join, uint32_t hash) {
+  return (uint32_t)(((uint64_t)hash << join->radix_bits) >> 32);
+}
+
+static uint32_t join_bucket(const join_t* join, uint32_t hash, uint32_t bucket_bits) {
+  return (uint32_t)(((uint64_t)(uint32_t)(hash << join->radix_bits) << bucket_bits) >> 32);
+}
+
+static void join_histogram_job(void* context, uint32_t job_index) {
+  join_t* join = (join_t*)context;
+  join_side_t* side = &join->sides[join->side];
+  uint32_t* histogram = side->histograms + ((size_t)job_index * join->partition_count);
+  const uint32_t begin = parallel_job_begin(side->count, side->job_count, job_index);
+  const uint32_t end = parallel_job_begin(side->count, side->job_count, job_index + 1);
+
+  memset(histogram, 0, join->partition_count * sizeof(uint32_t));
+  for (uint32_t index = begin; index < end; ++index) {
+    ++histogram[join_partition(join, join_hash(side->keys[index]))];
+  }
+}
+
+static void join_scatter_job(void* context, uint32_t job_index) {
+  join_t* join = (join_t*)context;
+  join_side_t* side = &join->sides[join->side];
+  uint32_t* offsets = side->histograms + ((size_t)job_index * join->partition_count);
+  const uint32_t begin = parallel_job_begin(side->count, side->job_count, job_index);
+  const uint32_t end = parallel_job_begin(side->count, side->job_count, job_index + 1);
+
+  for (uint32_t index = begin; index < end; ++index) {
+    const uint32_t key = side->keys[index];
+    const uint32_t offset = offsets[join_partition(join, join_hash(key))]++;
+    side->keys_partitioned[offset] = key;
+    side->indices_partitioned[offset] = index;
+  }
+}
+
+// splits one input into partitions, the same way radix_sort does one pass
+static void join_partition_side(join_t* join, uint32_t side_index) {
+  join_side_t* side = &join->sides[side_index];
+  join->side = side_index;
+  s_config.parallel_for(&join_histogram_job, join, side->job_count);
+
+  // turn the per-job counts into per-job starting offsets: partition-major, then job order
+  uint32_t offset = 0;
+  for (uint32_t partition = 0; partition < join->partition_count; ++partition) {
+    side->starts[partition] = offset;
+    for (uint32_t job_index = 0; job_index < side->job_count; ++job_index) {
+      uint32_t* slot = side->histograms + ((size_t)job_index * join->partition_count) + partition;
+      const uint32_t partition_count = *slot;
+      *slot = offset;
+      offset += partition_count;
+    }
+  }
+  side->starts[join->partition_count] = offset;
+
+  s_config.parallel_for(&join_scatter_job, join, side->job_count);
+}
+
+// Builds the job's table over the build keys of a partition, with a power of 2 bucket count at or above the key
+// count. Returns the bucket bits.
+static uint32_t join_build(const join_t* join, uint32_t partition, uint32_t* heads, uint32_t* chains) {
+  const join_side_t* build = &join->sides[0];
+  const uint32_t begin = build->starts[partition];
+  const uint32_t count = build->starts[partition + 1] - begin;
+  const uint32_t bucket_bits = floor_log2_u32(next_pow_2(count));
+
+  memset(heads, 0xff, ((size_t)1 << bucket_bits) * sizeof(uint32_t));
+  for (uint32_t position = 0; position < count; ++position) {
+    uint32_t* head = &heads[join_bucket(join, join_hash(build->keys_partitioned[begin + position]), bucket_bits)];
+    chains[position] = *head;
+    *head = position;
+  }
+  return bucket_bits;
+}
+
+// Walks the probe keys of a partition through the job's table. Counts the matches when *build_out* is NULL, otherwise
+// writes them from *offset* on. Returns the number of matches.
+static uint64_t join_probe(const join_t* join, uint32_t partition, const uint32_t* heads, const uint32_t* chains, uint32_t bucket_bits, uint32_t* build_out, uint32_t* probe_out, uint64_t offset) {
+  const uint32_t* build_keys = join->sides[0].keys_partitioned + join->sides[0].starts[partition];
+  const uint32_t* build_indices = join->sides[0].indices_partitioned + join->sides[0].starts[partition];
+  const join_side_t* probe = &join->sides[1];
+  const uint64_t offset_begin = offset;
+  for (uint32_t position = probe->starts[partition]; position < probe->starts[partition + 1]; ++position) {
+    const uint32_t key = probe->keys_partitioned[position];
+    for (uint32_t match = heads[join_bucket(join, join_hash(key), bucket_bits)]; match != JOIN_NONE; match = chains[match]) {
+      if (build_keys[match] == key) {
+        if (build_out != NULL) {
+          build_out[offset] = build_indices[match];
+          probe_out[offset] = probe->indices_partitioned[position];
+        }
+        ++offset;
+      }
+    }
+  }
+  return offset - offset_begin;
+}
+
+static void join_count_job(void* context, uint32_t job_index) {
+  join_t* join = (join_t*)context;
+  uint32_t* heads = join->heads + ((size_t)job_index * join->heads_per_job);
+  uint32_t* chains = join->chains + ((size_t)job_index * join->chains_per_job);
+  const uint32_t begin = parallel_job_begin(join->partition_count, join->job_count, job_index);
+  const uint32_t end = parallel_job_begin(join->partition_count, join->job_count, job_index + 1);
+  for (uint32_t partition = begin; partition < end; ++partition) {
+    const uint32_t bucket_bits = join_build(join, partition, heads, chains);
+    join->match_starts[partition] = join_probe(join, partition, heads, chains, bucket_bits, NULL, NULL, 0);
+  }
+}
+
+static void join_emit_job(void* context, uint32_t job_index) {
+  join_t* join = (join_t*)context;
+  uint32_t* heads = join->heads + ((size_t)job_index * join->heads_per_job);
+  uint32_t* chains = join->chains + ((size_t)job_index * join->chains_per_job);
+  const uint32_t begin = parallel_job_begin(join->partition_count, join->job_count, job_index);
+  const uint32_t end = parallel_job_begin(join->partition_count, join->job_count, job_index + 1);
+  for (uint32_t partition = begin; partition < end; ++partition) {
+    const uint32_t bucket_bits = join_build(join, partition, heads, chains);
+    join_probe(join, partition, heads, chains, bucket_bits, join->build_out, join->probe_out, join->match_starts[partition]);
+  }
+}
+
+uint32_t hash_join_u32(const uint32_t* build_keys, const uint32_t* probe_keys, uint32_t** build_indices, uint32_t** probe_indices, void* allocator) {
+  const uint32_t build_count = array_count(build_keys);
+  const uint32_t probe_count = array_count(probe_keys);
+  if (build_count == 0 || probe_count == 0) {
+    return 0;
+  }
+
+  // enough partitions for each build partition's table to stay in cache
+  join_t join;
+  join.radix_bits = 0;
+  while (join.radix_bits < JOIN_MAX_RADIX_BITS && ((uint64_t)JOIN_PARTITION_KEYS << join.radix_bits) < build_count) {
+    ++join.radix_bits;
+  }
+  join.partition_count = 1u << join.radix_bits;
+
+  // the partitioned copies are flat arrays as big as the inputs, so they take the large (huge page) path like tables
+  const uint32_t* inputs[2] = {build_keys, probe_keys};
+  for (uint32_t side_index = 0; side_index < 2; ++side_index) {
+    join_side_t* side = &join.sides[side_index];
+    side->keys = inputs[side_index];
+    side->count = array_count(inputs[side_index]);
+    side->job_count = parallel_job_count(side->count);
+    side->histograms = (uint32_t*)CONTAINERS_ALLOC((size_t)side->job_count * join.partition_count * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+    side->keys_partitioned = (uint32_t*)TABLE_ALLOC((size_t)side->count * sizeof(uint32_t), &side->keys_partitioned_class, allocator);
+    side->indices_partitioned = (uint32_t*)TABLE_ALLOC((size_t)side->count * sizeof(uint32_t), &side->indices_partitioned_class, allocator);
+    side->starts = (uint32_t*)CONTAINERS_ALLOC(((size_t)join.partition_count + 1) * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+    join_partition_side(&join, side_index);
+  }
+
+  // size the per-job tables for the largest build partition
+  uint32_t partition_max = 1;
+  for (uint32_t partition = 0; partition < join.partition_count; ++partition) {
+    const uint32_t partition_count = join.sides[0].starts[partition + 1] - join.sides[0].starts[partition];
+    partition_max = partition_count > partition_max ? partition_count : partition_max;
+  }
+  const uint32_t job_count = parallel_job_count(build_count > probe_count ? build_count : probe_count);
+  join.job_count = job_count < join.partition_count ? job_count : join.partition_count;
+  join.heads_per_job = next_pow_2(partition_max);
+  join.chains_per_job = partition_max;
+  join.heads = (uint32_t*)TABLE_ALLOC((size_t)join.job_count * join.heads_per_job * sizeof(uint32_t), &join.heads_class, allocator);
+  join.chains = (uint32_t*)TABLE_ALLOC((size_t)join.job_count * join.chains_per_job * sizeof(uint32_t), &join.chains_class, allocator);
+  join.match_starts = (uint64_t*)CONTAINERS_ALLOC((size_t)join.partition_count * sizeof(uint64_t), allocator, __FILE__, __LINE__, __func__);
+
+  // count, size the outputs once, then build and probe again to fill them
+  s_config.parallel_for(&join_count_job, &join, join.job_count);
+
+  uint64_t match_count = 0;
+  for (uint32_t partition = 0; partition < join.partition_count; ++partition) {
+    const uint64_t partition_matches = join.match_starts[partition];
+    join.match_starts[partition] = match_count;
+    match_count += partition_matches;
+  }
+
+  const uint32_t out_count = array_count(*build_indices);
+#ifdef CONTAINERS_CHECK_ENABLED
+  if (match_count > 0xffffffffu - out_count || out_count != array_count(*probe_indices)) {
+    CONTAINERS_ASSERT_FAILED("out_count + match_count <= 0xffffffff", "the join output must fit in an array and both outputs must start the same length", __FILE__, __LINE__, __func__);
+  }
+#endif
+
+  if (match_count > 0) {
+    array_reserve_more(*build_indices, (uint32_t)match_count, allocator);
+    array_reserve_more(*probe_indices, (uint32_t)match_count, allocator);
+    join.build_out = *build_indices + out_count;
+    join.probe_out = *probe_indices + out_count;
+    s_config.parallel_for(&join_emit_job, &join, join.job_count);
+    array__raw_count(*build_indices) += (uint32_t)match_count;
+    array__raw_count(*probe_indices) += (uint32_t)match_count;
+  }
+
+  CONTAINERS_FREE(join.match_starts, allocator, __FILE__, __LINE__, __func__);
+  TABLE_FREE(join.chains, (size_t)join.job_count * join.chains_per_job * sizeof(uint32_t), join.chains_class, allocator);
+  TABLE_FREE(join.heads, (size_t)join.job_count * join.heads_per_job * sizeof(uint32_t), join.heads_class, allocator);
+  for (uint32_t side_index = 0; side_index < 2; ++side_index) {
+    join_side_t* side = &join.sides[side_index];
+    CONTAINERS_FREE(side->starts, allocator, __FILE__, __LINE__, __func__);
+    TABLE_FREE(side->indices_partitioned, (size_t)side->count * sizeof(uint32_t), side->indices_partitioned_class, allocator);
+    TABLE_FREE(side->keys_partitioned, (size_t)side->count * sizeof(uint32_t), side->keys_partitioned_class, allocator);
+    CONTAINERS_FREE(side->histograms, allocator, __FILE__, __LINE__, __func__);
+  }
+  return (uint32_t)match_count;
+}
+
+void sorted_index_init(sorted_index_t* index, const uint32_t* sorted_arr, void* allocator) {
+  memset(index, 0, sizeof(*index));
+  const uint32_t count = array_count(sorted_arr);
+  index->count = count;
+  if (count == 0) {
+    return;
+  }
+
+#ifdef CONTAINERS_CHECK_ENABLED
+  for (uint32_t rank = 1; rank < count; ++rank) {
+    if (sorted_arr[rank - 1] > sorted_arr[rank]) {
+      CONTAINERS_ASSERT_FAILED("sorted_arr[rank - 1] <= sorted_arr[rank]", "the keys must be sorted in ascending order", __FILE__, __LINE__, __func__);
+      break;
+    }
+  }
+#endif
+
+  // size the layers: the leaves hold the keys and each layer above has a node per 17 nodes below it
+  uint32_t node_counts[SORTED_INDEX_MAX_LAYERS];
+  size_t words = 0;
+  node_counts[0] = (count + SORTED_INDEX_NODE_KEYS - 1) / SORTED_INDEX_NODE_KEYS;
+  index->layer_count = 1;
+  while (node_counts[index->layer_count - 1] > 1) {
+    node_counts[index->layer_count] = (node_counts[index->layer_count - 1] + SORTED_INDEX_FANOUT - 1) / SORTED_INDEX_FANOUT;
+    ++index->layer_count;
+  }
+  for (uint32_t layer = 0; layer < index->layer_count; ++layer) {
+    index->layer_offsets[layer] = (uint32_t)words;
+    words += (size_t)node_counts[layer] * SORTED_INDEX_NODE_KEYS;
+  }
+  index->keys = (uint32_t*)TABLE_ALLOC(words * sizeof(uint32_t), &index->keys_class, allocator);
+
+  // the padding at the end of the leaves never counts as less than a value, so it never moves a rank past *count*
+  memcpy(index->keys, sorted_arr, count * sizeof(uint32_t));
+  for (size_t word = count; word < (size_t)node_counts[0] * SORTED_INDEX_NODE_KEYS; ++word) {
+    index->keys[word] = UINT32_MAX;
+  }
+
+  // key i of a node is the first key under its child i + 1; whole subtrees of padding get the padding key
+  uint64_t leaves_per_child = 1;
+  for (uint32_t layer = 1; layer < index->layer_count; ++layer) {
+    uint32_t* node_keys = index->keys + index->layer_offsets[layer];
+    for (uint32_t node = 0; node < node_counts[layer]; ++node) {
+      for (uint32_t key = 0; key < SORTED_INDEX_NODE_KEYS; ++key) {
+        const uint64_t leaf = ((uint64_t)node * SORTED_INDEX_FANOUT + key + 1) * leaves_per_child;
+        node_keys[(size_t)node * SORTED_INDEX_NODE_KEYS + key] = leaf < node_counts[0] ? index->keys[leaf * SORTED_INDEX_NODE_KEYS] : UINT32_MAX;
+      }
+    }
+    leaves_per_child *= SORTED_INDEX_FANOUT;
+  }
+}
+
+// the node layers follow the leaves, so the allocation ends with the single root node
+static size_t sorted_index_size_bytes(const sorted_index_t* index) {
+  return ((size_t)index->layer_offsets[index->layer_count - 1] + SORTED_INDEX_NODE_KEYS) * sizeof(uint32_t);
+}
+
+void sorted_index_free(sorted_index_t* index, void* allocator) {
+  if (index->keys != NULL) {
+    TABLE_FREE(index->keys, sorted_index_size_bytes(index), index->keys_class, allocator);
+  }
+  memset(index, 0, sizeof(*index));
+}
+
+uint32_t sorted_index_count(const sorted_index_t* index) {
+  return index->count;
+}
+
+const uint32_t* sorted_index_keys(const sorted_index_t* index) {
+  return index->keys;
+}
+
+uint32_t sorted_index_lower_bound(const sorted_index_t* index, uint32_t value) {
+  if (index->count == 0) {
+    return 0;
+  }
+  const uint32_t rank = s_kernels->sorted_index_rank(index, value);
+  return rank < index->count ? rank : index->count;
+}
+
+uint32_t sorted_index_upper_bound(const sorted_index_t* index, uint32_t value) {
+  return value == UINT32_MAX ? index->count : sorted_index_lower_bound(index, value + 1);
+}
+
+uint32_t sorted_index_range(const sorted_index_t* index, uint32_t min, uint32_t max, uint32_t* begin) {
+  *begin = sorted_index_lower_bound(index, min);
+  if (max < min) {
+    return 0;
+  }
+  return sorted_index_upper_bound(index, max) - *begin;
+}
+
+static slot_map_handle_t slot_map_handle(const slot_map_t* map, uint32_t slot) {
+  return ((uint64_t)map->generations[slot] << 32) | slot;
+}
+
+// finds the slot for a live handle, or returns SLOT_MAP_SLOT_NONE for a stale or foreign one
+static uint32_t slot_map_slot(const slot_map_t* map, slot_map_handle_t handle) {
+  const uint32_t slot = (uint32_t)handle;
+  const uint32_t generation = (uint32_t)(handle >> 32);
+  if (slot >= array_count(map->generations) || map->generations[slot] != generation || (generation & 1) == 0) {
+    return SLOT_MAP_SLOT_NONE;
+  }
+  return slot;
+}
+
+void slot_map_init(slot_map_t* map, uint32_t item_size) {
+  memset(map, 0, sizeof(*map));
+  map->free_head = SLOT_MAP_SLOT_NONE;
+  map->item_size = item_size;
+}
+
+void slot_map_free(slot_map_t* map, void* allocator) {
+  array_free(map->values, allocator);
+  array_free(map->value_slots, allocator);
+  array_free(map->slots, allocator);
+  array_free(map->generations, allocator);
+  slot_map_init(map, map->item_size);
+}
+
+uint32_t slot_map_count(const slot_map_t* map) {
+  return array_count(map->value_slots);
+}
+
+void slot_map_reserve(slot_map_t* map, uint32_t capacity, void* allocator) {
+  if (capacity > array_capacity(map->values)) {
+    map->values = (uint8_t*)containers__array_grow_impl(map->values, capacity - array_count(map->values), map->item_size, allocator, __FILE__, __LINE__, __func__);
+  }
+  array_reserve(map->value_slots, capacity, allocator);
+  array_reserve(map->slots, capacity, allocator);
+  array_reserve(map->generations, capacity, allocator);
+}
+
+slot_map_handle_t slot_map_insert(slot_map_t* map, const void* item, void* allocator) {
+  const uint32_t index = array_count(map->value_slots);
+
+  // take a slot off the free list, or add a new one
+  uint32_t slot = map->free_head;
+  if (slot != SLOT_MAP_SLOT_NONE) {
+    map->free_head = map->slots[slot];
+    map->slots[slot] = index;
+    ++map->generations[slot];
+  }
+  else {
+    slot = array_count(map->slots);
+    array_push(map->slots, index, allocator);
+    array_push(map->generations, 1, allocator);
+  }
+
+  if (array__should_grow(map->values, 1)) {
+    map->values = (uint8_t*)containers__array_grow_impl(map->values, 1, map->item_size, allocator, __FILE__, __LINE__, __func__);
+  }
+  memcpy(map->values + ((size_t)index * map->item_size), item, map->item_size);
+  ++array__raw_count(map->values);
+  array_push(map->value_slots, slot, allocator);
+  return slot_map_handle(map, slot);
+}
+
+bool slot_map_remove(slot_map_t* map, slot_map_handle_t handle) {
+  const uint32_t slot = slot_map_slot(map, handle);
+  if (slot == SLOT_MAP_SLOT_NONE) {
+    return false;
+  }
+
+  // move the last item into the hole and point its slot at the new position
+  const uint32_t index = map->slots[slot];
+  const uint32_t last = array_count(map->value_slots) - 1;
+  if (index != last) {
+    memcpy(map->values + ((size_t)index * map->item_size), map->values + ((size_t)last * map->item_size), map->item_size);
+    map->value_slots[index] = map->value_slots[last];
+    map->slots[map->value_slots[index]] = index;
+  }
+  --array__raw_count(map->values);
+  --array__raw_count(map->value_slots);
+
+  // retire the handle and put the slot on the free list; a slot whose generation would wrap to 0 is retired for good
+  ++map->generations[slot];
+  if (map->generations[slot] != 0) {
+    map->slots[slot] = map->free_head;
+    map->free_head = slot;
+  }
+  return true;
+}
+
+bool slot_map_contains(const slot_map_t* map, slot_map_handle_t handle) {
+  return slot_map_slot(map, handle) != SLOT_MAP_SLOT_NONE;
+}
+
+void* slot_map_get(const slot_map_t* map, slot_map_handle_t handle) {
+  const uint32_t slot = slot_map_slot(map, handle);
+  if (slot == SLOT_MAP_SLOT_NONE) {
+    return NULL;
+  }
+  return map->values + ((size_t)map->slots[slot] * map->item_size);
+}
+
+void* slot_map_values(const slot_map_t* map) {
+  return map->values;
+}
+
+slot_map_handle_t slot_map_handle_at(const slot_map_t* map, uint32_t index) {
+#ifdef CONTAINERS_CHECK_ENABLED
+  if (index >= array_count(map->value_slots)) {
+    CONTAINERS_ASSERT_FAILED("index < slot_map_count(map)", "the index is past the end of the slot map", __FILE__, __LINE__, __func__);
+  }
+#endif
+  return slot_map_handle(map, map->value_slots[index]);
+}
+
+void containers__array_free_impl(void* arr, void* allocator, const char* file, int line, const char* func) {
+  void* ptr = array__header(arr);
+  CONTAINERS_FREE(ptr, allocator, file, line, func);
+}
+
+void* containers__array_grow_impl(void* arr, uint32_t inc, uint32_t item_size, void* allocator, const char* file, int line, const char* func) {
+  PROFILE_BEGIN(CONTAINERS_PROFILE_ARRAY_GROW);
+
+  // compute the new capacity
+  const uint32_t count_old = array_count(arr);
+  const uint32_t capacity_old = (arr == NULL) ? 0 : array__raw_capacity(arr);
+  const uint32_t capacity_required = count_old + inc;
+  const uint32_t capacity_doubled = 2 * capacity_old;
+  const uint32_t capacity_new = capacity_required > capacity_doubled ? capacity_required : capacity_doubled;
+
+  // realloc
+  array_header_t* ptr_new = (array_header_t*)CONTAINERS_ALLOC((capacity_new * item_size) + sizeof(array_header_t), allocator, file, line, func);
+  array_header_t* ptr_old = (arr == NULL) ? NULL : array__header(arr);
+  if (ptr_old != NULL) {
+    memmove(ptr_new, ptr_old, (count_old * item_size) + sizeof(array_header_t));
+    CONTAINERS_FREE(ptr_old, allocator, file, line, func);
+  }
+
+  // fix the header
+  ptr_new->capacity = capacity_new;
+  if (ptr_old == NULL) {
+    ptr_new->count = 0;
+  }
+
+  PROFILE_END(CONTAINERS_PROFILE_ARRAY_GROW);
+  return ptr_new + 1;
+}
+
+void containers__array_memcpy(void* dest, const void* src, uint32_t size_bytes) {
+  memcpy(dest, src, size_bytes);
+}
+
+void containers__array_check_min_count(void* arr, uint32_t min_count, const char* file, int line, const char* func) {
+  if (array_count(arr) < min_count) {
+    char message[64];
+    snprintf(message, 64, "array must contain at least %u element%s", min_count, min_count == 1 ? "" : "s");
+    CONTAINERS_ASSERT_FAILED("array_count(arr) < count_min", message, file, line, func);
+  }
+}
+
+typedef struct radix_sort_t {
+  void* keys[2];
+  uint32_t* values[2];
+  uint32_t* histograms; // 256 counts per job; turned into scatter offsets in place
+  uint32_t src;
+  uint32_t count;
+  uint32_t key_size;
+  uint32_t shift;
+  uint32_t job_count;
+} radix_sort_t;
+
+static void radix_sort_histogram_job(void* context, uint32_t job_index) {
+  radix_sort_t* sort = (radix_sort_t*)context;
+  uint32_t* histogram = sort->histograms + (job_index * 256);
+  const uint32_t begin = parallel_job_begin(sort->count, sort->job_count, job_index);
+  const uint32_t end = parallel_job_begin(sort->count, sort->job_count, job_index + 1);
+  const uint32_t shift = sort->shift;
+
+  memset(histogram, 0, 256 * sizeof(uint32_t));
+  if (sort->key_size == sizeof(uint32_t)) {
+    const uint32_t* keys = (const uint32_t*)sort->keys[sort->src];
+    for (uint32_t index = begin; index < end; ++index) {
+      ++histogram[(keys[index] >> shift) & 0xff];
+    }
+  }
+  else {
+    const uint64_t* keys = (const uint64_t*)sort->keys[sort->src];
+    for (uint32_t index = begin; index < end; ++index) {
+      ++histogram[(keys[index] >> shift) & 0xff];
+    }
+  }
+}
+
+static void radix_sort_scatter_job(void* context, uint32_t job_index) {
+  radix_sort_t* sort = (radix_sort_t*)context;
+  uint32_t* offsets = sort->histograms + (job_index * 256);
+  const uint32_t begin = parallel_job_begin(sort->count, sort->job_count, job_index);
+  const uint32_t end = parallel_job_begin(sort->count, sort->job_count, job_index + 1);
+  const uint32_t shift = sort->shift;
+  const uint32_t* values_src = sort->values[sort->src];
+  uint32_t* values_dst = sort->values[sort->src ^ 1];
+
+  if (sort->key_size == sizeof(uint32_t)) {
+    const uint32_t* keys_src = (const uint32_t*)sort->keys[sort->src];
+    uint32_t* keys_dst = (uint32_t*)sort->keys[sort->src ^ 1];
+    if (values_src == NULL) {
+      for (uint32_t index = begin; index < end; ++index) {
+        const uint32_t key = keys_src[index];
+        keys_dst[offsets[(key >> shift) & 0xff]++] = key;
+      }
+    }
+    else {
+      for (uint32_t index = begin; index < end; ++index) {
+        const uint32_t key = keys_src[index];
+        const uint32_t offset = offsets[(key >> shift) & 0xff]++;
+        keys_dst[offset] = key;
+        values_dst[offset] = values_src[index];
+      }
+    }
+  }
+  else {
+    const uint64_t* keys_src = (const uint64_t*)sort->keys[sort->src];
+    uint64_t* keys_dst = (uint64_t*)sort->keys[sort->src ^ 1];
+    if (values_src == NULL) {
+      for (uint32_t index = begin; index < end; ++index) {
+        const uint64_t key = keys_src[index];
+        keys_dst[offsets[(key >> shift) & 0xff]++] = key;
+      }
+    }
+    else {
+      for (uint32_t index = begin; index < end; ++index) {
+        const uint64_t key = keys_src[index];
+        const uint32_t offset = offsets[(key >> shift) & 0xff]++;
+        keys_dst[offset] = key;
+        values_dst[offset] = values_src[index];
+      }
+    }
+  }
+}
+
+static void radix_sort(void* keys, uint32_t* values, uint32_t key_size, void* allocator) {
+  const uint32_t count = array_count(keys);
+  if (count < 2) {
+    return;
+  }
+
+  radix_sort_t sort;
+  sort.count = count;
+  sort.key_size = key_size;
+  sort.job_count = parallel_job_count(count);
+  sort.src = 0;
+  sort.keys[0] = keys;
+  sort.keys[1] = CONTAINERS_ALLOC((size_t)count * key_size, allocator, __FILE__, __LINE__, __func__);
+  sort.values[0] = values;
+  sort.values[1] = (values == NULL) ? NULL : (uint32_t*)CONTAINERS_ALLOC((size_t)count * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+  sort.histograms = (uint32_t*)CONTAINERS_ALLOC((size_t)sort.job_count * 256 * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+
+  for (sort.shift = 0; sort.shift < key_size * 8; sort.shift += 8) {
+    s_config.parallel_for(&radix_sort_histogram_job, &sort, sort.job_count);
+
+    // turn the per-job counts into per-job starting offsets: digit-major, then job order to keep the sort stable
+    uint32_t offset = 0;
+    bool single_digit = false;
+    for (uint32_t digit = 0; digit < 256 && !single_digit; ++digit) {
+      const uint32_t offset_digit = offset;
+      for (uint32_t job_index = 0; job_index < sort.job_count; ++job_index) {
+        uint32_t* slot = sort.histograms + (job_index * 256) + digit;
+        const uint32_t digit_count = *slot;
+        *slot = offset;
+        offset += digit_count;
+      }
+      single_digit = (offset - offset_digit) == count;
+    }
+
+    // every key has the same digit in this position so the pass would not move anything
+    if (single_digit) {
+      continue;
+    }
+
+    s_config.parallel_for(&radix_sort_scatter_job, &sort, sort.job_count);
+    sort.src ^= 1;
+  }
+
+  // an odd number of passes leaves the result in the scratch buffers
+  if (sort.src != 0) {
+    memcpy(keys, sort.keys[1], (size_t)count * key_size);
+    if (values != NULL) {
+      memcpy(values, sort.values[1], (size_t)count * sizeof(uint32_t));
+    }
+  }
+
+  CONTAINERS_FREE(sort.histograms, allocator, __FILE__, __LINE__, __func__);
+  if (values != NULL) {
+    CONTAINERS_FREE(sort.values[1], allocator, __FILE__, __LINE__, __func__);
+  }
+  CONTAINERS_FREE(sort.keys[1], allocator, __FILE__, __LINE__, __func__);
+}
+
+void array_sort_u32(uint32_t* arr, void* allocator) {
+  radix_sort(arr, NULL, sizeof(uint32_t), allocator);
+}
+
+void array_sort_u64(uint64_t* arr, void* allocator) {
+  radix_sort(arr, NULL, sizeof(uint64_t), allocator);
+}
+
+void array_sort_pairs_u32(uint32_t* keys, uint32_t* values, void* allocator) {
+  radix_sort(keys, values, sizeof(uint32_t), allocator);
+}
+
+void array_sort_pairs_u64(uint64_t* keys, uint32_t* values, void* allocator) {
+  radix_sort(keys, values, sizeof(uint64_t), allocator);
+}
+
+//
+// simd kernels
+//
+
+static uint32_t find_u32_scalar(const uint32_t* arr, uint32_t count, uint32_t value) {
+  for (uint32_t index = 0; index < count; ++index) {
+    if (arr[index] == value) {
+      return index;
+    }
+  }
+  return ARRAY_INDEX_NONE;
+}
+
+static uint32_t find_not_u32_scalar(const uint32_t* arr, uint32_t count, uint32_t value) {
+  for (uint32_t index = 0; index < count; ++index) {
+    if (arr[index] != value) {
+      return index;
+    }
+  }
+  return ARRAY_INDEX_NONE;
+}
+
+// counts the keys of a 16 key node that are less than *value*
+static uint32_t sorted_index_node_rank_scalar(const uint32_t* node, uint32_t value) {
+  uint32_t rank = 0;
+  for (uint32_t key = 0; key < SORTED_INDEX_NODE_KEYS; ++key) {
+    rank += node[key] < value ? 1 : 0;
+  }
+  return rank;
+}
+
+// The rank kernels descend from the root, picking the child whose subtree holds the first key not less than *value*,
+// and return the rank of that key in the leaves (which may point into the padding when every key is less).
+static uint32_t sorted_index_rank_scalar(const sorted_index_t* index, uint32_t value) {
+  uint32_t node = 0;
+  for (uint32_t layer = index->layer_count - 1; layer > 0; --layer) {
+    const uint32_t* keys = index->keys + index->layer_offsets[layer] + (size_t)node * SORTED_INDEX_NODE_KEYS;
+    node = node * SORTED_INDEX_FANOUT + sorted_index_node_rank_scalar(keys, value);
+  }
+  return node * SORTED_INDEX_NODE_KEYS + sorted_index_node_rank_scalar(index->keys + (size_t)node * SORTED_INDEX_NODE_KEYS, value);
+}
+
+static uint32_t find_u64_scalar(const uint64_t* arr, uint32_t count, uint64_t value) {
+  for (uint32_t index = 0; index < count; ++index) {
+    if (arr[index] == value) {
+      return index;
+    }
+  }
+  return ARRAY_INDEX_NONE;
+}
+
+static uint32_t find_f32_scalar(const float* arr, uint32_t count, float value) {
+  for (uint32_t index = 0; index < count; ++index) {
+    if (arr[index] == value) {
+      return index;
+    }
+  }
+  return ARRAY_INDEX_NONE;
+}
+
+static uint32_t count_u32_scalar(const uint32_t* arr, uint32_t count, uint32_t value) {
+  uint32_t result = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    result += (arr[index] == value);
+  }
+  return result;
+}
+
+static uint32_t count_u64_scalar(const uint64_t* arr, uint32_t count, uint64_t value) {
+  uint32_t result = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    result += (arr[index] == value);
+  }
+  return result;
+}
+
+static uint32_t count_f32_scalar(const float* arr, uint32_t count, float value) {
+  uint32_t result = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    result += (arr[index] == value);
+  }
+  return result;
+}
+
+static uint32_t min_u32_scalar(const uint32_t* arr, uint32_t count) {
+  uint32_t result = UINT32_MAX;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] < result ? arr[index] : result;
+  }
+  return result;
+}
+
+static uint32_t max_u32_scalar(const uint32_t* arr, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] > result ? arr[index] : result;
+  }
+  return result;
+}
+
+static uint64_t min_u64_scalar(const uint64_t* arr, uint32_t count) {
+  uint64_t result = UINT64_MAX;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] < result ? arr[index] : result;
+  }
+  return result;
+}
+
+static uint64_t max_u64_scalar(const uint64_t* arr, uint32_t count) {
+  uint64_t result = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] > result ? arr[index] : result;
+  }
+  return result;
+}
+
+// the float reductions start at infinity and only take non-NaN elements (a comparison with NaN is false)
+static float min_f32_scalar(const float* arr, uint32_t count) {
+  float result = INFINITY;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] < result ? arr[index] : result;
+  }
+  return result;
+}
+
+static float max_f32_scalar(const float* arr, uint32_t count) {
+  float result = -INFINITY;
+  for (uint32_t index = 0; index < count; ++index) {
+    result = arr[index] > result ? arr[index] : result;
+  }
+  return result;
+}
+
+// moves the kept run [begin, end) down to *write* and returns the new write position
+static uint32_t compact_run(uint8_t* arr, uint32_t item_size, uint32_t begin, uint32_t end, uint32_t write) {
+  if (write != begin && end > begin) {
+    memmove(arr + ((size_t)write * item_size), arr + ((size_t)begin * item_size), (size_t)(end - begin) * item_size);
+  }
+  return write + (end - begin);
+}
+
+// removes the elements in [begin, count) whose mask bit is set, given that *write* elements have been kept so far. Runs
+// of kept elements are moved with one memmove each and all-zero mask words are skipped whole.
+static uint32_t compact_mask_scalar(void* arr, uint32_t item_size, uint32_t count, const uint64_t* mask, uint32_t begin, uint32_t write) {
+  uint8_t* items = (uint8_t*)arr;
+  uint32_t run_begin = begin;
+  for (uint32_t word_begin = begin & ~63u; word_begin < count; word_begin += 64) {
+    uint64_t remove = mask[word_begin / 64];
+    // ignore bits before the start and past the end
+    remove &= ~0ull << (begin > word_begin ? begin - word_begin : 0);
+    if (count - word_begin < 64) {
+      remove &= (1ull << (count - word_begin)) - 1;
+    }
+    while (remove != 0) {
+      const uint32_t index = word_begin + count_trailing_zeros_u64(remove);
+      write = compact_run(items, item_size, run_begin, index, write);
+      run_begin = index + 1;
+      remove &= remove - 1;
+    }
+  }
+  return compact_run(items, item_size, run_begin, count, write);
+}
+
+static uint32_t compact_mask_32_scalar(void* arr, uint32_t count, const uint64_t* mask) {
+  return compact_mask_scalar(arr, 4, count, mask, 0, 0);
+}
+
+static uint32_t compact_mask_64_scalar(void* arr, uint32_t count, const uint64_t* mask) {
+  return compact_mask_scalar(arr, 8, count, mask, 0, 0);
+}
+
+static const simd_kernels_t s_kernels_scalar = {
+  &find_u32_scalar,
+  &find_u64_scalar,
+  &find_f32_scalar,
+  &count_u32_scalar,
+  &count_u64_scalar,
+  &count_f32_scalar,
+  &min_u32_scalar,
+  &max_u32_scalar,
+  &min_u64_scalar,
+  &max_u64_scalar,
+  &min_f32_scalar,
+  &max_f32_scalar,
+  &compact_mask_32_scalar,
+  &compact_mask_64_scalar,
+  &find_not_u32_scalar,
+  &sorted_index_rank_scalar,
+};
+
+#ifdef CONTAINERS_X86
+// The SIMD kernels all follow the same shape: an unrolled main loop over several vectors at a time and the next smaller
+// kernel for the remainder. The find kernels hand the block containing the first hit to the scalar kernel to pick out the index.
+
+//
+// sse2 (baseline on x86-64)
+//
+
+static uint32_t hsum_u32_sse2(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+static __m128i cmpeq_u64_sse2(__m128i a, __m128i b) {
+  const __m128i eq32 = _mm_cmpeq_epi32(a, b);
+  return _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+// sse2 has no unsigned compare; flipping the sign bit turns it into a signed one
+static __m128i min_u32_flipped_sse2(__m128i a, __m128i b) {
+  const __m128i less = _mm_cmplt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+}
+
+static __m128i max_u32_flipped_sse2(__m128i a, __m128i b) {
+  const __m128i greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+
+static uint32_t find_u32_sse2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m128i needle = _mm_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    const __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 0), needle);
+    const __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 1), needle);
+    const __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 2), needle);
+    const __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 3), needle);
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3))) != 0) {
+      return index + find_u32_scalar(arr + index, 16, value);
+    }
+  }
+  const uint32_t found = find_u32_scalar(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+static uint32_t find_not_u32_sse2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m128i needle = _mm_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    const __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 0), needle);
+    const __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 1), needle);
+    const __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 2), needle);
+    const __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128(src + 3), needle);
+    if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(eq0, eq1), _mm_and_si128(eq2, eq3))) != 0xffff) {
+      return index + find_not_u32_scalar(arr + index, 16, value);
+    }
+  }
+  const uint32_t found = find_not_u32_scalar(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+// the compare masks are all ones (-1) per lane, so subtracting them counts the keys less than *value*
+static uint32_t sorted_index_node_rank_sse2(const uint32_t* node, uint32_t value) {
+  const __m128i flip = _mm_set1_epi32((int)0x80000000u);
+  const __m128i needle = _mm_xor_si128(_mm_set1_epi32((int)value), flip);
+  const __m128i* src = (const __m128i*)node;
+  __m128i acc = _mm_setzero_si128();
+  acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(needle, _mm_xor_si128(_mm_load_si128(src + 0), flip)));
+  acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(needle, _mm_xor_si128(_mm_load_si128(src + 1), flip)));
+  acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(needle, _mm_xor_si128(_mm_load_si128(src + 2), flip)));
+  acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(needle, _mm_xor_si128(_mm_load_si128(src + 3), flip)));
+  return hsum_u32_sse2(acc);
+}
+
+static uint32_t sorted_index_rank_sse2(const sorted_index_t* index, uint32_t value) {
+  uint32_t node = 0;
+  for (uint32_t layer = index->layer_count - 1; layer > 0; --layer) {
+    const uint32_t* keys = index->keys + index->layer_offsets[layer] + (size_t)node * SORTED_INDEX_NODE_KEYS;
+    node = node * SORTED_INDEX_FANOUT + sorted_index_node_rank_sse2(keys, value);
+  }
+  return node * SORTED_INDEX_NODE_KEYS + sorted_index_node_rank_sse2(index->keys + (size_t)node * SORTED_INDEX_NODE_KEYS, value);
+}
+
+static uint32_t find_u64_sse2(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m128i needle = _mm_set1_epi64x((long long)value);
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    const __m128i eq0 = cmpeq_u64_sse2(_mm_loadu_si128(src + 0), needle);
+    const __m128i eq1 = cmpeq_u64_sse2(_mm_loadu_si128(src + 1), needle);
+    const __m128i eq2 = cmpeq_u64_sse2(_mm_loadu_si128(src + 2), needle);
+    const __m128i eq3 = cmpeq_u64_sse2(_mm_loadu_si128(src + 3), needle);
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3))) != 0) {
+      return index + find_u64_scalar(arr + index, 8, value);
+    }
+  }
+  const uint32_t found = find_u64_scalar(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+static uint32_t find_f32_sse2(const float* arr, uint32_t count, float value) {
+  const __m128 needle = _mm_set1_ps(value);
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const float* src = arr + index;
+    const __m128 eq0 = _mm_cmpeq_ps(_mm_loadu_ps(src + 0), needle);
+    const __m128 eq1 = _mm_cmpeq_ps(_mm_loadu_ps(src + 4), needle);
+    const __m128 eq2 = _mm_cmpeq_ps(_mm_loadu_ps(src + 8), needle);
+    const __m128 eq3 = _mm_cmpeq_ps(_mm_loadu_ps(src + 12), needle);
+    if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(eq0, eq1), _mm_or_ps(eq2, eq3))) != 0) {
+      return index + find_f32_scalar(arr + index, 16, value);
+    }
+  }
+  const uint32_t found = find_f32_scalar(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+static uint32_t count_u32_sse2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m128i needle = _mm_set1_epi32((int)value);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    // a match is all ones (-1) so subtracting it counts
+    acc0 = _mm_sub_epi32(acc0, _mm_cmpeq_epi32(_mm_loadu_si128(src + 0), needle));
+    acc1 = _mm_sub_epi32(acc1, _mm_cmpeq_epi32(_mm_loadu_si128(src + 1), needle));
+  }
+  return hsum_u32_sse2(_mm_add_epi32(acc0, acc1)) + count_u32_scalar(arr + index, count - index, value);
+}
+
+static uint32_t count_u64_sse2(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m128i needle = _mm_set1_epi64x((long long)value);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  uint32_t index = 0;
+  for (; index + 4 <= count; index += 4) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    acc0 = _mm_sub_epi64(acc0, cmpeq_u64_sse2(_mm_loadu_si128(src + 0), needle));
+    acc1 = _mm_sub_epi64(acc1, cmpeq_u64_sse2(_mm_loadu_si128(src + 1), needle));
+  }
+  // the 64-bit lane counts fit in their low halves
+  return hsum_u32_sse2(_mm_add_epi64(acc0, acc1)) + count_u64_scalar(arr + index, count - index, value);
+}
+
+static uint32_t count_f32_sse2(const float* arr, uint32_t count, float value) {
+  const __m128 needle = _mm_set1_ps(value);
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    acc0 = _mm_sub_epi32(acc0, _mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps(arr + index), needle)));
+    acc1 = _mm_sub_epi32(acc1, _mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps(arr + index + 4), needle)));
+  }
+  return hsum_u32_sse2(_mm_add_epi32(acc0, acc1)) + count_f32_scalar(arr + index, count - index, value);
+}
+
+static uint32_t min_u32_sse2(const uint32_t* arr, uint32_t count) {
+  const __m128i flip = _mm_set1_epi32((int)0x80000000u);
+  __m128i acc0 = _mm_set1_epi32(INT32_MAX);
+  __m128i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    acc0 = min_u32_flipped_sse2(_mm_xor_si128(_mm_loadu_si128(src + 0), flip), acc0);
+    acc1 = min_u32_flipped_sse2(_mm_xor_si128(_mm_loadu_si128(src + 1), flip), acc1);
+  }
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, _mm_xor_si128(min_u32_flipped_sse2(acc0, acc1), flip));
+  const uint32_t lanes_min = min_u32_scalar(lanes, 4);
+  const uint32_t tail_min = min_u32_scalar(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+static uint32_t max_u32_sse2(const uint32_t* arr, uint32_t count) {
+  const __m128i flip = _mm_set1_epi32((int)0x80000000u);
+  __m128i acc0 = _mm_set1_epi32(INT32_MIN);
+  __m128i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m128i* src = (const __m128i*)(arr + index);
+    acc0 = max_u32_flipped_sse2(_mm_xor_si128(_mm_loadu_si128(src + 0), flip), acc0);
+    acc1 = max_u32_flipped_sse2(_mm_xor_si128(_mm_loadu_si128(src + 1), flip), acc1);
+  }
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, _mm_xor_si128(max_u32_flipped_sse2(acc0, acc1), flip));
+  const uint32_t lanes_max = max_u32_scalar(lanes, 4);
+  const uint32_t tail_max = max_u32_scalar(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+// minps/maxps return the second operand when either is NaN, so keeping the accumulator second skips NaNs
+static float min_f32_sse2(const float* arr, uint32_t count) {
+  __m128 acc0 = _mm_set1_ps(INFINITY);
+  __m128 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    acc0 = _mm_min_ps(_mm_loadu_ps(arr + index), acc0);
+    acc1 = _mm_min_ps(_mm_loadu_ps(arr + index + 4), acc1);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_min_ps(acc0, acc1));
+  const float lanes_min = min_f32_scalar(lanes, 4);
+  const float tail_min = min_f32_scalar(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+static float max_f32_sse2(const float* arr, uint32_t count) {
+  __m128 acc0 = _mm_set1_ps(-INFINITY);
+  __m128 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    acc0 = _mm_max_ps(_mm_loadu_ps(arr + index), acc0);
+    acc1 = _mm_max_ps(_mm_loadu_ps(arr + index + 4), acc1);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_max_ps(acc0, acc1));
+  const float lanes_max = max_f32_scalar(lanes, 4);
+  const float tail_max = max_f32_scalar(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+//
+// avx2
+//
+
+CONTAINERS_TARGET_AVX2 static uint32_t hsum_u32_avx2(__m256i v) {
+  return hsum_u32_sse2(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+// avx2 has no unsigned 64-bit compare; flipping the sign bit turns it into a signed one
+CONTAINERS_TARGET_AVX2 static __m256i min_u64_flipped_avx2(__m256i a, __m256i b) {
+  return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+CONTAINERS_TARGET_AVX2 static __m256i max_u64_flipped_avx2(__m256i a, __m256i b) {
+  return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t find_u32_avx2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m256i needle = _mm256_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    const __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 0), needle);
+    const __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 1), needle);
+    const __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 2), needle);
+    const __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 3), needle);
+    const __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+    if (!_mm256_testz_si256(any, any)) {
+      return index + find_u32_scalar(arr + index, 32, value);
+    }
+  }
+  const uint32_t found = find_u32_sse2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t find_not_u32_avx2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m256i needle = _mm256_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    const __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 0), needle);
+    const __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 1), needle);
+    const __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 2), needle);
+    const __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 3), needle);
+    const __m256i all = _mm256_and_si256(_mm256_and_si256(eq0, eq1), _mm256_and_si256(eq2, eq3));
+    if ((uint32_t)_mm256_movemask_epi8(all) != 0xffffffffu) {
+      return index + find_not_u32_scalar(arr + index, 32, value);
+    }
+  }
+  const uint32_t found = find_not_u32_sse2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t sorted_index_node_rank_avx2(const uint32_t* node, uint32_t value) {
+  const __m256i flip = _mm256_set1_epi32((int)0x80000000u);
+  const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32((int)value), flip);
+  const __m256i* src = (const __m256i*)node;
+  const __m256i less0 = _mm256_cmpgt_epi32(needle, _mm256_xor_si256(_mm256_load_si256(src + 0), flip));
+  const __m256i less1 = _mm256_cmpgt_epi32(needle, _mm256_xor_si256(_mm256_load_si256(src + 1), flip));
+  return hsum_u32_avx2(_mm256_sub_epi32(_mm256_setzero_si256(), _mm256_add_epi32(less0, less1)));
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t sorted_index_rank_avx2(const sorted_index_t* index, uint32_t value) {
+  uint32_t node = 0;
+  for (uint32_t layer = index->layer_count - 1; layer > 0; --layer) {
+    const uint32_t* keys = index->keys + index->layer_offsets[layer] + (size_t)node * SORTED_INDEX_NODE_KEYS;
+    node = node * SORTED_INDEX_FANOUT + sorted_index_node_rank_avx2(keys, value);
+  }
+  return node * SORTED_INDEX_NODE_KEYS + sorted_index_node_rank_avx2(index->keys + (size_t)node * SORTED_INDEX_NODE_KEYS, value);
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t find_u64_avx2(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m256i needle = _mm256_set1_epi64x((long long)value);
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    const __m256i eq0 = _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 0), needle);
+    const __m256i eq1 = _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 1), needle);
+    const __m256i eq2 = _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 2), needle);
+    const __m256i eq3 = _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 3), needle);
+    const __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+    if (!_mm256_testz_si256(any, any)) {
+      return index + find_u64_scalar(arr + index, 16, value);
+    }
+  }
+  const uint32_t found = find_u64_sse2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t find_f32_avx2(const float* arr, uint32_t count, float value) {
+  const __m256 needle = _mm256_set1_ps(value);
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    const float* src = arr + index;
+    const __m256 eq0 = _mm256_cmp_ps(_mm256_loadu_ps(src + 0), needle, _CMP_EQ_OQ);
+    const __m256 eq1 = _mm256_cmp_ps(_mm256_loadu_ps(src + 8), needle, _CMP_EQ_OQ);
+    const __m256 eq2 = _mm256_cmp_ps(_mm256_loadu_ps(src + 16), needle, _CMP_EQ_OQ);
+    const __m256 eq3 = _mm256_cmp_ps(_mm256_loadu_ps(src + 24), needle, _CMP_EQ_OQ);
+    if (_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(eq0, eq1), _mm256_or_ps(eq2, eq3))) != 0) {
+      return index + find_f32_scalar(arr + index, 32, value);
+    }
+  }
+  const uint32_t found = find_f32_sse2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX2 static uint32_t count_u32_avx2(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m256i needle = _mm256_set1_epi32((int)value);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = _mm256_sub_epi32(acc0, _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 0), needle));
+    acc1 = _mm256_sub_epi32(acc1, _mm256_cmpeq_epi32(_mm256_loadu_si256(src + 1), needle));
+  }
+  return hsum_u32_avx2(_mm256_add_epi32(acc0, acc1)) + count_u32_sse2(arr + index, count - index, value);
+}
 
-  // fix the header
-  ptr_new->capacity = capacity_new;
-  if (ptr_old == NULL) {
-    ptr_new->count = 0;
+CONTAINERS_TARGET_AVX2 static uint32_t count_u64_avx2(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m256i needle = _mm256_set1_epi64x((long long)value);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = _mm256_sub_epi64(acc0, _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 0), needle));
+    acc1 = _mm256_sub_epi64(acc1, _mm256_cmpeq_epi64(_mm256_loadu_si256(src + 1), needle));
   }
+  return hsum_u32_avx2(_mm256_add_epi64(acc0, acc1)) + count_u64_sse2(arr + index, count - index, value);
+}
 
-  return ptr_new + 1;
+CONTAINERS_TARGET_AVX2 static uint32_t count_f32_avx2(const float* arr, uint32_t count, float value) {
+  const __m256 needle = _mm256_set1_ps(value);
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm256_sub_epi32(acc0, _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(arr + index), needle, _CMP_EQ_OQ)));
+    acc1 = _mm256_sub_epi32(acc1, _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(arr + index + 8), needle, _CMP_EQ_OQ)));
+  }
+  return hsum_u32_avx2(_mm256_add_epi32(acc0, acc1)) + count_f32_sse2(arr + index, count - index, value);
 }
 
-void containers__array_memcpy(void* dest, const void* src, uint32_t size_bytes) {
-  memcpy(dest, src, size_bytes);
+CONTAINERS_TARGET_AVX2 static uint32_t min_u32_avx2(const uint32_t* arr, uint32_t count) {
+  __m256i acc0 = _mm256_set1_epi32(-1);
+  __m256i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = _mm256_min_epu32(_mm256_loadu_si256(src + 0), acc0);
+    acc1 = _mm256_min_epu32(_mm256_loadu_si256(src + 1), acc1);
+  }
+  uint32_t lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_min_epu32(acc0, acc1));
+  const uint32_t lanes_min = min_u32_scalar(lanes, 8);
+  const uint32_t tail_min = min_u32_scalar(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
 }
 
-void containers__array_check_min_count(void* arr, uint32_t min_count, const char* file, int line, const char* func) {
-  if (array_count(arr) < min_count) {
-    char message[64];
-    snprintf(message, 64, "array must contain at least %u element%s", min_count, min_count == 1 ? "" : "s");
-    s_config.assert_failed("array_count(arr) < count_min", message, file, line, func);
+CONTAINERS_TARGET_AVX2 static uint32_t max_u32_avx2(const uint32_t* arr, uint32_t count) {
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = _mm256_max_epu32(_mm256_loadu_si256(src + 0), acc0);
+    acc1 = _mm256_max_epu32(_mm256_loadu_si256(src + 1), acc1);
+  }
+  uint32_t lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_max_epu32(acc0, acc1));
+  const uint32_t lanes_max = max_u32_scalar(lanes, 8);
+  const uint32_t tail_max = max_u32_scalar(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+CONTAINERS_TARGET_AVX2 static uint64_t min_u64_avx2(const uint64_t* arr, uint32_t count) {
+  const __m256i flip = _mm256_set1_epi64x(INT64_MIN);
+  __m256i acc0 = _mm256_set1_epi64x(INT64_MAX);
+  __m256i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = min_u64_flipped_avx2(_mm256_xor_si256(_mm256_loadu_si256(src + 0), flip), acc0);
+    acc1 = min_u64_flipped_avx2(_mm256_xor_si256(_mm256_loadu_si256(src + 1), flip), acc1);
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_xor_si256(min_u64_flipped_avx2(acc0, acc1), flip));
+  const uint64_t lanes_min = min_u64_scalar(lanes, 4);
+  const uint64_t tail_min = min_u64_scalar(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+CONTAINERS_TARGET_AVX2 static uint64_t max_u64_avx2(const uint64_t* arr, uint32_t count) {
+  const __m256i flip = _mm256_set1_epi64x(INT64_MIN);
+  __m256i acc0 = flip;
+  __m256i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    const __m256i* src = (const __m256i*)(arr + index);
+    acc0 = max_u64_flipped_avx2(_mm256_xor_si256(_mm256_loadu_si256(src + 0), flip), acc0);
+    acc1 = max_u64_flipped_avx2(_mm256_xor_si256(_mm256_loadu_si256(src + 1), flip), acc1);
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, _mm256_xor_si256(max_u64_flipped_avx2(acc0, acc1), flip));
+  const uint64_t lanes_max = max_u64_scalar(lanes, 4);
+  const uint64_t tail_max = max_u64_scalar(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+CONTAINERS_TARGET_AVX2 static float min_f32_avx2(const float* arr, uint32_t count) {
+  __m256 acc0 = _mm256_set1_ps(INFINITY);
+  __m256 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm256_min_ps(_mm256_loadu_ps(arr + index), acc0);
+    acc1 = _mm256_min_ps(_mm256_loadu_ps(arr + index + 8), acc1);
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, _mm256_min_ps(acc0, acc1));
+  const float lanes_min = min_f32_scalar(lanes, 8);
+  const float tail_min = min_f32_scalar(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+CONTAINERS_TARGET_AVX2 static float max_f32_avx2(const float* arr, uint32_t count) {
+  __m256 acc0 = _mm256_set1_ps(-INFINITY);
+  __m256 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm256_max_ps(_mm256_loadu_ps(arr + index), acc0);
+    acc1 = _mm256_max_ps(_mm256_loadu_ps(arr + index + 8), acc1);
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, _mm256_max_ps(acc0, acc1));
+  const float lanes_max = max_f32_scalar(lanes, 8);
+  const float tail_max = max_f32_scalar(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+//
+// avx-512 (foundation only)
+//
+
+CONTAINERS_TARGET_AVX512 static uint32_t find_u32_avx512(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m512i needle = _mm512_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 64 <= count; index += 64) {
+    const uint32_t* src = arr + index;
+    const __mmask16 eq0 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(src + 0), needle);
+    const __mmask16 eq1 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(src + 16), needle);
+    const __mmask16 eq2 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(src + 32), needle);
+    const __mmask16 eq3 = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(src + 48), needle);
+    if ((eq0 | eq1 | eq2 | eq3) != 0) {
+      return index + find_u32_scalar(src, 64, value);
+    }
+  }
+  const uint32_t found = find_u32_avx2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t find_not_u32_avx512(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m512i needle = _mm512_set1_epi32((int)value);
+  uint32_t index = 0;
+  for (; index + 64 <= count; index += 64) {
+    const uint32_t* src = arr + index;
+    const __mmask16 ne0 = _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(src + 0), needle);
+    const __mmask16 ne1 = _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(src + 16), needle);
+    const __mmask16 ne2 = _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(src + 32), needle);
+    const __mmask16 ne3 = _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(src + 48), needle);
+    if ((ne0 | ne1 | ne2 | ne3) != 0) {
+      return index + find_not_u32_scalar(src, 64, value);
+    }
+  }
+  const uint32_t found = find_not_u32_avx2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+// a node is exactly one 512-bit vector, compared unsigned in a single instruction
+CONTAINERS_TARGET_AVX512 static uint32_t sorted_index_node_rank_avx512(const uint32_t* node, uint32_t value) {
+  const __mmask16 less = _mm512_cmplt_epu32_mask(_mm512_load_si512(node), _mm512_set1_epi32((int)value));
+  return (uint32_t)_mm_popcnt_u32(less);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t sorted_index_rank_avx512(const sorted_index_t* index, uint32_t value) {
+  uint32_t node = 0;
+  for (uint32_t layer = index->layer_count - 1; layer > 0; --layer) {
+    const uint32_t* keys = index->keys + index->layer_offsets[layer] + (size_t)node * SORTED_INDEX_NODE_KEYS;
+    node = node * SORTED_INDEX_FANOUT + sorted_index_node_rank_avx512(keys, value);
+  }
+  return node * SORTED_INDEX_NODE_KEYS + sorted_index_node_rank_avx512(index->keys + (size_t)node * SORTED_INDEX_NODE_KEYS, value);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t find_u64_avx512(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m512i needle = _mm512_set1_epi64((long long)value);
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    const uint64_t* src = arr + index;
+    const __mmask8 eq0 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(src + 0), needle);
+    const __mmask8 eq1 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(src + 8), needle);
+    const __mmask8 eq2 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(src + 16), needle);
+    const __mmask8 eq3 = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(src + 24), needle);
+    if ((eq0 | eq1 | eq2 | eq3) != 0) {
+      return index + find_u64_scalar(src, 32, value);
+    }
+  }
+  const uint32_t found = find_u64_avx2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t find_f32_avx512(const float* arr, uint32_t count, float value) {
+  const __m512 needle = _mm512_set1_ps(value);
+  uint32_t index = 0;
+  for (; index + 64 <= count; index += 64) {
+    const float* src = arr + index;
+    const __mmask16 eq0 = _mm512_cmp_ps_mask(_mm512_loadu_ps(src + 0), needle, _CMP_EQ_OQ);
+    const __mmask16 eq1 = _mm512_cmp_ps_mask(_mm512_loadu_ps(src + 16), needle, _CMP_EQ_OQ);
+    const __mmask16 eq2 = _mm512_cmp_ps_mask(_mm512_loadu_ps(src + 32), needle, _CMP_EQ_OQ);
+    const __mmask16 eq3 = _mm512_cmp_ps_mask(_mm512_loadu_ps(src + 48), needle, _CMP_EQ_OQ);
+    if ((eq0 | eq1 | eq2 | eq3) != 0) {
+      return index + find_f32_scalar(src, 64, value);
+    }
+  }
+  const uint32_t found = find_f32_avx2(arr + index, count - index, value);
+  return found == ARRAY_INDEX_NONE ? found : index + found;
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t count_u32_avx512(const uint32_t* arr, uint32_t count, uint32_t value) {
+  const __m512i needle = _mm512_set1_epi32((int)value);
+  const __m512i one = _mm512_set1_epi32(1);
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = _mm512_setzero_si512();
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_mask_add_epi32(acc0, _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(arr + index), needle), acc0, one);
+    acc1 = _mm512_mask_add_epi32(acc1, _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(arr + index + 16), needle), acc1, one);
+  }
+  return (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(acc0, acc1)) + count_u32_avx2(arr + index, count - index, value);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t count_u64_avx512(const uint64_t* arr, uint32_t count, uint64_t value) {
+  const __m512i needle = _mm512_set1_epi64((long long)value);
+  const __m512i one = _mm512_set1_epi64(1);
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = _mm512_setzero_si512();
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm512_mask_add_epi64(acc0, _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(arr + index), needle), acc0, one);
+    acc1 = _mm512_mask_add_epi64(acc1, _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(arr + index + 8), needle), acc1, one);
+  }
+  return (uint32_t)_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1)) + count_u64_avx2(arr + index, count - index, value);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t count_f32_avx512(const float* arr, uint32_t count, float value) {
+  const __m512 needle = _mm512_set1_ps(value);
+  const __m512i one = _mm512_set1_epi32(1);
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = _mm512_setzero_si512();
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_mask_add_epi32(acc0, _mm512_cmp_ps_mask(_mm512_loadu_ps(arr + index), needle, _CMP_EQ_OQ), acc0, one);
+    acc1 = _mm512_mask_add_epi32(acc1, _mm512_cmp_ps_mask(_mm512_loadu_ps(arr + index + 16), needle, _CMP_EQ_OQ), acc1, one);
+  }
+  return (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(acc0, acc1)) + count_f32_avx2(arr + index, count - index, value);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t min_u32_avx512(const uint32_t* arr, uint32_t count) {
+  __m512i acc0 = _mm512_set1_epi32(-1);
+  __m512i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_min_epu32(_mm512_loadu_si512(arr + index), acc0);
+    acc1 = _mm512_min_epu32(_mm512_loadu_si512(arr + index + 16), acc1);
+  }
+  const uint32_t lanes_min = (uint32_t)_mm512_reduce_min_epu32(_mm512_min_epu32(acc0, acc1));
+  const uint32_t tail_min = min_u32_avx2(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t max_u32_avx512(const uint32_t* arr, uint32_t count) {
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_max_epu32(_mm512_loadu_si512(arr + index), acc0);
+    acc1 = _mm512_max_epu32(_mm512_loadu_si512(arr + index + 16), acc1);
+  }
+  const uint32_t lanes_max = (uint32_t)_mm512_reduce_max_epu32(_mm512_max_epu32(acc0, acc1));
+  const uint32_t tail_max = max_u32_avx2(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+CONTAINERS_TARGET_AVX512 static uint64_t min_u64_avx512(const uint64_t* arr, uint32_t count) {
+  __m512i acc0 = _mm512_set1_epi64(-1);
+  __m512i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm512_min_epu64(_mm512_loadu_si512(arr + index), acc0);
+    acc1 = _mm512_min_epu64(_mm512_loadu_si512(arr + index + 8), acc1);
+  }
+  const uint64_t lanes_min = (uint64_t)_mm512_reduce_min_epu64(_mm512_min_epu64(acc0, acc1));
+  const uint64_t tail_min = min_u64_avx2(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+CONTAINERS_TARGET_AVX512 static uint64_t max_u64_avx512(const uint64_t* arr, uint32_t count) {
+  __m512i acc0 = _mm512_setzero_si512();
+  __m512i acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 16 <= count; index += 16) {
+    acc0 = _mm512_max_epu64(_mm512_loadu_si512(arr + index), acc0);
+    acc1 = _mm512_max_epu64(_mm512_loadu_si512(arr + index + 8), acc1);
+  }
+  const uint64_t lanes_max = (uint64_t)_mm512_reduce_max_epu64(_mm512_max_epu64(acc0, acc1));
+  const uint64_t tail_max = max_u64_avx2(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+CONTAINERS_TARGET_AVX512 static float min_f32_avx512(const float* arr, uint32_t count) {
+  __m512 acc0 = _mm512_set1_ps(INFINITY);
+  __m512 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_min_ps(_mm512_loadu_ps(arr + index), acc0);
+    acc1 = _mm512_min_ps(_mm512_loadu_ps(arr + index + 16), acc1);
+  }
+  float lanes[16];
+  _mm512_storeu_ps(lanes, _mm512_min_ps(acc0, acc1));
+  const float lanes_min = min_f32_scalar(lanes, 16);
+  const float tail_min = min_f32_avx2(arr + index, count - index);
+  return lanes_min < tail_min ? lanes_min : tail_min;
+}
+
+CONTAINERS_TARGET_AVX512 static float max_f32_avx512(const float* arr, uint32_t count) {
+  __m512 acc0 = _mm512_set1_ps(-INFINITY);
+  __m512 acc1 = acc0;
+  uint32_t index = 0;
+  for (; index + 32 <= count; index += 32) {
+    acc0 = _mm512_max_ps(_mm512_loadu_ps(arr + index), acc0);
+    acc1 = _mm512_max_ps(_mm512_loadu_ps(arr + index + 16), acc1);
+  }
+  float lanes[16];
+  _mm512_storeu_ps(lanes, _mm512_max_ps(acc0, acc1));
+  const float lanes_max = max_f32_scalar(lanes, 16);
+  const float tail_max = max_f32_avx2(arr + index, count - index);
+  return lanes_max > tail_max ? lanes_max : tail_max;
+}
+
+// compress-stores the kept lanes of each vector; a mask word with nothing to remove and nothing to shift is skipped
+CONTAINERS_TARGET_AVX512 static uint32_t compact_mask_32_avx512(void* arr, uint32_t count, const uint64_t* mask) {
+  uint32_t* items = (uint32_t*)arr;
+  uint32_t write = 0;
+  uint32_t index = 0;
+  for (; index + 64 <= count; index += 64) {
+    const uint64_t remove = mask[index / 64];
+    if (remove == 0 && write == index) {
+      write += 64;
+      continue;
+    }
+    for (uint32_t lane = 0; lane < 64; lane += 16) {
+      const __mmask16 keep = (__mmask16) ~(remove >> lane);
+      const __m512i values = _mm512_loadu_si512(items + index + lane);
+      _mm512_mask_compressstoreu_epi32(items + write, keep, values);
+      write += (uint32_t)_mm_popcnt_u32(keep);
+    }
+  }
+  return compact_mask_scalar(arr, 4, count, mask, index, write);
+}
+
+CONTAINERS_TARGET_AVX512 static uint32_t compact_mask_64_avx512(void* arr, uint32_t count, const uint64_t* mask) {
+  uint64_t* items = (uint64_t*)arr;
+  uint32_t write = 0;
+  uint32_t index = 0;
+  for (; index + 64 <= count; index += 64) {
+    const uint64_t remove = mask[index / 64];
+    if (remove == 0 && write == index) {
+      write += 64;
+      continue;
+    }
+    for (uint32_t lane = 0; lane < 64; lane += 8) {
+      const __mmask8 keep = (__mmask8) ~(remove >> lane);
+      const __m512i values = _mm512_loadu_si512(items + index + lane);
+      _mm512_mask_compressstoreu_epi64(items + write, keep, values);
+      write += (uint32_t)_mm_popcnt_u32(keep);
+    }
+  }
+  return compact_mask_scalar(arr, 8, count, mask, index, write);
+}
+
+static const simd_kernels_t s_kernels_sse2 = {
+  &find_u32_sse2,
+  &find_u64_sse2,
+  &find_f32_sse2,
+  &count_u32_sse2,
+  &count_u64_sse2,
+  &count_f32_sse2,
+  &min_u32_sse2,
+  &max_u32_sse2,
+  &min_u64_scalar, // no 64-bit compare before sse4.2
+  &max_u64_scalar,
+  &min_f32_sse2,
+  &max_f32_sse2,
+  &compact_mask_32_scalar, // no compress instruction before avx-512
+  &compact_mask_64_scalar,
+  &find_not_u32_sse2,
+  &sorted_index_rank_sse2,
+};
+
+static const simd_kernels_t s_kernels_avx2 = {
+  &find_u32_avx2,
+  &find_u64_avx2,
+  &find_f32_avx2,
+  &count_u32_avx2,
+  &count_u64_avx2,
+  &count_f32_avx2,
+  &min_u32_avx2,
+  &max_u32_avx2,
+  &min_u64_avx2,
+  &max_u64_avx2,
+  &min_f32_avx2,
+  &max_f32_avx2,
+  &compact_mask_32_scalar,
+  &compact_mask_64_scalar,
+  &find_not_u32_avx2,
+  &sorted_index_rank_avx2,
+};
+
+static const simd_kernels_t s_kernels_avx512 = {
+  &find_u32_avx512,
+  &find_u64_avx512,
+  &find_f32_avx512,
+  &count_u32_avx512,
+  &count_u64_avx512,
+  &count_f32_avx512,
+  &min_u32_avx512,
+  &max_u32_avx512,
+  &min_u64_avx512,
+  &max_u64_avx512,
+  &min_f32_avx512,
+  &max_f32_avx512,
+  &compact_mask_32_avx512,
+  &compact_mask_64_avx512,
+  &find_not_u32_avx512,
+  &sorted_index_rank_avx512,
+};
+#endif // CONTAINERS_X86
+
+// gets the best instruction set the cpu (and os) supports
+static containers_simd_t cpu_simd_level() {
+#if !defined(CONTAINERS_X86)
+  return CONTAINERS_SIMD_SCALAR;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  int regs[4];
+  __cpuid(regs, 0);
+  const int leaf_max = regs[0];
+  __cpuid(regs, 1);
+  const bool osxsave = (regs[2] & (1 << 27)) != 0;
+  const bool avx = (regs[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || leaf_max < 7) {
+    return CONTAINERS_SIMD_SSE2;
+  }
+  // the os must save the ymm (and for avx-512 the zmm/opmask) registers across context switches
+  const unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(regs, 7, 0);
+  const bool avx2 = (regs[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+  const bool avx512f = (regs[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+  return avx512f ? CONTAINERS_SIMD_AVX512 : avx2 ? CONTAINERS_SIMD_AVX2 : CONTAINERS_SIMD_SSE2;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return CONTAINERS_SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return CONTAINERS_SIMD_AVX2;
+  }
+  return CONTAINERS_SIMD_SSE2;
+#endif
+}
+
+static void simd_kernels_select(containers_simd_t level_requested) {
+  const containers_simd_t level_cpu = cpu_simd_level();
+  s_simd_level = level_requested < level_cpu ? level_requested : level_cpu;
+  switch (s_simd_level) {
+#ifdef CONTAINERS_X86
+    case CONTAINERS_SIMD_AVX512:
+      s_kernels = &s_kernels_avx512;
+      break;
+    case CONTAINERS_SIMD_AVX2:
+      s_kernels = &s_kernels_avx2;
+      break;
+    case CONTAINERS_SIMD_SSE2:
+      s_kernels = &s_kernels_sse2;
+      break;
+#endif
+    default:
+      s_kernels = &s_kernels_scalar;
+      break;
+  }
+}
+
+uint32_t array_find_first_u32(const uint32_t* arr, uint32_t value) {
+  return s_kernels->find_u32(arr, array_count(arr), value);
+}
+
+uint32_t array_find_first_u64(const uint64_t* arr, uint64_t value) {
+  return s_kernels->find_u64(arr, array_count(arr), value);
+}
+
+uint32_t array_find_first_f32(const float* arr, float value) {
+  return s_kernels->find_f32(arr, array_count(arr), value);
+}
+
+uint32_t array_count_equal_u32(const uint32_t* arr, uint32_t value) {
+  return s_kernels->count_u32(arr, array_count(arr), value);
+}
+
+uint32_t array_count_equal_u64(const uint64_t* arr, uint64_t value) {
+  return s_kernels->count_u64(arr, array_count(arr), value);
+}
+
+uint32_t array_count_equal_f32(const float* arr, float value) {
+  return s_kernels->count_f32(arr, array_count(arr), value);
+}
+
+bool array_contains_u32(const uint32_t* arr, uint32_t value) {
+  return array_find_first_u32(arr, value) != ARRAY_INDEX_NONE;
+}
+
+bool array_contains_u64(const uint64_t* arr, uint64_t value) {
+  return array_find_first_u64(arr, value) != ARRAY_INDEX_NONE;
+}
+
+bool array_contains_f32(const float* arr, float value) {
+  return array_find_first_f32(arr, value) != ARRAY_INDEX_NONE;
+}
+
+// the min/max index functions reduce to the extreme value (branch-free and vectorizable) and then find its first
+// occurrence, rather than tracking an index per lane
+uint32_t array_min_index_u32(const uint32_t* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_u32(arr, count, s_kernels->min_u32(arr, count));
+}
+
+uint32_t array_min_index_u64(const uint64_t* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_u64(arr, count, s_kernels->min_u64(arr, count));
+}
+
+uint32_t array_min_index_f32(const float* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_f32(arr, count, s_kernels->min_f32(arr, count));
+}
+
+uint32_t array_max_index_u32(const uint32_t* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_u32(arr, count, s_kernels->max_u32(arr, count));
+}
+
+uint32_t array_max_index_u64(const uint64_t* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_u64(arr, count, s_kernels->max_u64(arr, count));
+}
+
+uint32_t array_max_index_f32(const float* arr) {
+  const uint32_t count = array_count(arr);
+  return count == 0 ? ARRAY_INDEX_NONE : s_kernels->find_f32(arr, count, s_kernels->max_f32(arr, count));
+}
+
+uint32_t containers__array_remove_if_impl(void* arr, uint32_t count, uint32_t item_size, bool (*predicate)(const void* item, void* context), void* context) {
+  uint8_t* items = (uint8_t*)arr;
+  uint32_t write = 0;
+  uint32_t run_begin = 0;
+  for (uint32_t index = 0; index < count; ++index) {
+    if (predicate(items + ((size_t)index * item_size), context)) {
+      write = compact_run(items, item_size, run_begin, index, write);
+      run_begin = index + 1;
+    }
+  }
+  return compact_run(items, item_size, run_begin, count, write);
+}
+
+uint32_t containers__array_remove_mask_impl(void* arr, uint32_t count, uint32_t item_size, const uint64_t* mask) {
+  if (item_size == 4) {
+    return s_kernels->compact_mask_32(arr, count, mask);
+  }
+  if (item_size == 8) {
+    return s_kernels->compact_mask_64(arr, count, mask);
+  }
+  return compact_mask_scalar(arr, item_size, count, mask, 0, 0);
+}
+
+uint32_t containers__array_remove_indices_impl(void* arr, uint32_t count, uint32_t item_size, const uint32_t* indices, uint32_t index_count, const char* file, int line, const char* func) {
+  uint8_t* items = (uint8_t*)arr;
+  uint32_t write = 0;
+  uint32_t run_begin = 0;
+  for (uint32_t position = 0; position < index_count; ++position) {
+    const uint32_t index = indices[position];
+#ifdef CONTAINERS_CHECK_ENABLED
+    if (index >= count || index < run_begin) {
+      CONTAINERS_ASSERT_FAILED("index < count && index >= previous + 1", "indices must be ascending, unique and in range", file, line, func);
+      break;
+    }
+#endif
+    write = compact_run(items, item_size, run_begin, index, write);
+    run_begin = index + 1;
+  }
+  return compact_run(items, item_size, run_begin, count, write);
+}
+
+// copies *count* items into a ring buffer starting at *index*, wrapping at the end of the buffer
+static void ring_write(uint8_t* ring, uint32_t capacity, uint32_t item_size, uint32_t index, const void* items, uint32_t count) {
+  const uint32_t start = index & (capacity - 1);
+  const uint32_t count_first = (capacity - start) < count ? (capacity - start) : count;
+  memcpy(ring + ((size_t)start * item_size), items, (size_t)count_first * item_size);
+  memcpy(ring, (const uint8_t*)items + ((size_t)count_first * item_size), (size_t)(count - count_first) * item_size);
+}
+
+// copies *count* items out of a ring buffer starting at *index*, wrapping at the end of the buffer
+static void ring_read(const uint8_t* ring, uint32_t capacity, uint32_t item_size, uint32_t index, void* items, uint32_t count) {
+  const uint32_t start = index & (capacity - 1);
+  const uint32_t count_first = (capacity - start) < count ? (capacity - start) : count;
+  memcpy(items, ring + ((size_t)start * item_size), (size_t)count_first * item_size);
+  memcpy((uint8_t*)items + ((size_t)count_first * item_size), ring, (size_t)(count - count_first) * item_size);
+}
+
+void spsc_queue_init(spsc_queue_t* queue, uint32_t capacity, uint32_t item_size, void* allocator) {
+  memset(queue, 0, sizeof(*queue));
+  queue->capacity = next_pow_2(capacity);
+  queue->item_size = item_size;
+  queue->items = (uint8_t*)CONTAINERS_ALLOC((size_t)queue->capacity * item_size, allocator, __FILE__, __LINE__, __func__);
+}
+
+void spsc_queue_free(spsc_queue_t* queue, void* allocator) {
+  if (queue->items != NULL) {
+    CONTAINERS_FREE(queue->items, allocator, __FILE__, __LINE__, __func__);
+  }
+  memset(queue, 0, sizeof(*queue));
+}
+
+uint32_t spsc_queue_count(const spsc_queue_t* queue) {
+  const uint32_t head = atomic_u32_load_acquire(&queue->head);
+  const uint32_t tail = atomic_u32_load_acquire(&queue->tail);
+  return tail - head;
+}
+
+bool spsc_queue_push(spsc_queue_t* queue, const void* item) {
+  return spsc_queue_push_n(queue, item, 1) == 1;
+}
+
+uint32_t spsc_queue_push_n(spsc_queue_t* queue, const void* items, uint32_t count) {
+  const uint32_t capacity = queue->capacity;
+  const uint32_t tail = atomic_u32_load_relaxed(&queue->tail);
+
+  // only go to the consumer's cache line when the cached head says there isn't enough room
+  uint32_t free_count = capacity - (tail - queue->head_cached);
+  if (free_count < count) {
+    queue->head_cached = atomic_u32_load_acquire(&queue->head);
+    free_count = capacity - (tail - queue->head_cached);
+  }
+
+  const uint32_t push_count = count < free_count ? count : free_count;
+  if (push_count == 0) {
+    return 0;
+  }
+
+  ring_write(queue->items, capacity, queue->item_size, tail, items, push_count);
+  atomic_u32_store_release(&queue->tail, tail + push_count);
+  return push_count;
+}
+
+bool spsc_queue_pop(spsc_queue_t* queue, void* item) {
+  return spsc_queue_pop_n(queue, item, 1) == 1;
+}
+
+uint32_t spsc_queue_pop_n(spsc_queue_t* queue, void* items, uint32_t count) {
+  const uint32_t head = atomic_u32_load_relaxed(&queue->head);
+
+  // only go to the producer's cache line when the cached tail says there aren't enough items
+  uint32_t used_count = queue->tail_cached - head;
+  if (used_count < count) {
+    queue->tail_cached = atomic_u32_load_acquire(&queue->tail);
+    used_count = queue->tail_cached - head;
+  }
+
+  const uint32_t pop_count = count < used_count ? count : used_count;
+  if (pop_count == 0) {
+    return 0;
+  }
+
+  ring_read(queue->items, queue->capacity, queue->item_size, head, items, pop_count);
+  atomic_u32_store_release(&queue->head, head + pop_count);
+  return pop_count;
+}
+
+void mpmc_queue_init(mpmc_queue_t* queue, uint32_t capacity, uint32_t item_size, void* allocator) {
+  memset(queue, 0, sizeof(*queue));
+  queue->capacity = next_pow_2(capacity);
+  queue->item_size = item_size;
+  queue->sequences = (uint32_t*)CONTAINERS_ALLOC(queue->capacity * sizeof(uint32_t), allocator, __FILE__, __LINE__, __func__);
+  queue->items = (uint8_t*)CONTAINERS_ALLOC((size_t)queue->capacity * item_size, allocator, __FILE__, __LINE__, __func__);
+
+  // each cell starts out free for the producer whose position matches its index
+  for (uint32_t index = 0; index < queue->capacity; ++index) {
+    queue->sequences[index] = index;
+  }
+}
+
+void mpmc_queue_free(mpmc_queue_t* queue, void* allocator) {
+  if (queue->sequences != NULL) {
+    CONTAINERS_FREE(queue->sequences, allocator, __FILE__, __LINE__, __func__);
+    CONTAINERS_FREE(queue->items, allocator, __FILE__, __LINE__, __func__);
+  }
+  memset(queue, 0, sizeof(*queue));
+}
+
+uint32_t mpmc_queue_count(const mpmc_queue_t* queue) {
+  const uint32_t head = atomic_u32_load_acquire(&queue->head);
+  const uint32_t tail = atomic_u32_load_acquire(&queue->tail);
+  const uint32_t count = tail - head;
+  // the two loads are not taken together, so clamp anything that looks like the indices crossed
+  return count > queue->capacity ? 0 : count;
+}
+
+bool mpmc_queue_push(mpmc_queue_t* queue, const void* item) {
+  return mpmc_queue_push_n(queue, item, 1) == 1;
+}
+
+uint32_t mpmc_queue_push_n(mpmc_queue_t* queue, const void* items, uint32_t count) {
+  uint32_t* sequences = queue->sequences;
+  const uint32_t mask = queue->capacity - 1;
+  if (count == 0 || queue->capacity == 0) {
+    return 0;
+  }
+
+  for (;;) {
+    const uint32_t pos = atomic_u32_load_relaxed(&queue->tail);
+
+    // measure the run of free cells starting at the tail
+    uint32_t push_count = 0;
+    while (push_count < count && atomic_u32_load_acquire(&sequences[(pos + push_count) & mask]) == pos + push_count) {
+      ++push_count;
+    }
+
+    if (push_count == 0) {
+      // the cell still holds an item from the previous lap; the queue is full
+      const int32_t diff = (int32_t)(atomic_u32_load_acquire(&sequences[pos & mask]) - pos);
+      if (diff < 0) {
+        return 0;
+      }
+      // another producer claimed this position; try again from the new tail
+      continue;
+    }
+
+    // claim the run and publish each cell to the consumers
+    if (atomic_u32_cas(&queue->tail, pos, pos + push_count)) {
+      for (uint32_t offset = 0; offset < push_count; ++offset) {
+        const uint32_t index = (pos + offset) & mask;
+        memcpy(queue->items + ((size_t)index * queue->item_size), (const uint8_t*)items + ((size_t)offset * queue->item_size), queue->item_size);
+        atomic_u32_store_release(&sequences[index], pos + offset + 1);
+      }
+      return push_count;
+    }
+  }
+}
+
+bool mpmc_queue_pop(mpmc_queue_t* queue, void* item) {
+  return mpmc_queue_pop_n(queue, item, 1) == 1;
+}
+
+uint32_t mpmc_queue_pop_n(mpmc_queue_t* queue, void* items, uint32_t count) {
+  uint32_t* sequences = queue->sequences;
+  const uint32_t capacity = queue->capacity;
+  const uint32_t mask = capacity - 1;
+  if (count == 0 || capacity == 0) {
+    return 0;
+  }
+
+  for (;;) {
+    const uint32_t pos = atomic_u32_load_relaxed(&queue->head);
+
+    // measure the run of published cells starting at the head
+    uint32_t pop_count = 0;
+    while (pop_count < count && atomic_u32_load_acquire(&sequences[(pos + pop_count) & mask]) == pos + pop_count + 1) {
+      ++pop_count;
+    }
+
+    if (pop_count == 0) {
+      // the cell has not been published yet; the queue is empty
+      const int32_t diff = (int32_t)(atomic_u32_load_acquire(&sequences[pos & mask]) - (pos + 1));
+      if (diff < 0) {
+        return 0;
+      }
+      // another consumer claimed this position; try again from the new head
+      continue;
+    }
+
+    // claim the run and hand each cell back to the producers for the next lap
+    if (atomic_u32_cas(&queue->head, pos, pos + pop_count)) {
+      for (uint32_t offset = 0; offset < pop_count; ++offset) {
+        const uint32_t index = (pos + offset) & mask;
+        memcpy((uint8_t*)items + ((size_t)offset * queue->item_size), queue->items + ((size_t)index * queue->item_size), queue->item_size);
+        atomic_u32_store_release(&sequences[index], pos + offset + capacity);
+      }
+      return pop_count;
+    }
+  }
+}
+
+// segment k holds 1024 << k items, so biasing the index by 1024 makes its top bit pick the segment
+static uint32_t segmented_array_locate(uint32_t index, uint32_t* offset) {
+  const uint32_t biased = index + (1u << SEGMENTED_ARRAY_FIRST_SEGMENT_BITS);
+  const uint32_t top_bit = floor_log2_u32(biased);
+  *offset = biased - (1u << top_bit);
+  return top_bit - SEGMENTED_ARRAY_FIRST_SEGMENT_BITS;
+}
+
+static uint32_t segmented_array_segment_capacity(uint32_t segment) {
+  return 1u << (segment + SEGMENTED_ARRAY_FIRST_SEGMENT_BITS);
+}
+
+// the ready bitmap is padded to whole cache lines so the items behind it start aligned
+static size_t segmented_array_bitmap_bytes(uint32_t segment) {
+  return round_up(segmented_array_segment_capacity(segment) / 8, CONTAINERS_CACHE_LINE_SIZE);
+}
+
+static size_t segmented_array_segment_bytes(const segmented_array_t* arr, uint32_t segment) {
+  return segmented_array_bitmap_bytes(segment) + ((size_t)segmented_array_segment_capacity(segment) * arr->item_size);
+}
+
+static uint8_t* segmented_array_segment(segmented_array_t* arr, uint32_t segment, void* allocator) {
+  uint8_t* memory = (uint8_t*)atomic_ptr_load_acquire((void* const*)&arr->segments[segment]);
+  if (memory != NULL) {
+    return memory;
+  }
+
+  // every thread that reaches a missing segment allocates one; the first to install it wins and the rest free theirs
+  const size_t size_bytes = segmented_array_segment_bytes(arr, segment);
+  uint8_t fresh_class;
+  uint8_t* fresh = (uint8_t*)TABLE_ALLOC(size_bytes, &fresh_class, allocator);
+  memset(fresh, 0, segmented_array_bitmap_bytes(segment));
+  if (atomic_ptr_cas((void**)&arr->segments[segment], NULL, fresh)) {
+    // only read by segmented_array_free, once pushes are done
+    arr->segment_classes[segment] = fresh_class;
+    return fresh;
+  }
+  TABLE_FREE(fresh, size_bytes, fresh_class, allocator);
+  return (uint8_t*)atomic_ptr_load_acquire((void* const*)&arr->segments[segment]);
+}
+
+// Moves the published count past the run of ready slots at its end. Every push calls this after marking its own slots,
+// so whichever push fills the last gap publishes the run. The ready bits are set and read sequentially consistent so
+// two pushes finishing together can't both miss the other's slots and leave the count stuck.
+static void segmented_array_publish(segmented_array_t* arr) {
+  uint32_t published = atomic_u32_load_acquire(&arr->published);
+  for (;;) {
+    uint32_t end = published;
+    for (;;) {
+      uint32_t offset;
+      const uint32_t segment = segmented_array_locate(end, &offset);
+      if (segment >= SEGMENTED_ARRAY_SEGMENT_COUNT) {
+        break;
+      }
+      const uint32_t* ready_bits = (const uint32_t*)atomic_ptr_load_acquire((void* const*)&arr->segments[segment]);
+      if (ready_bits == NULL) {
+        break;
+      }
+
+      // count the ready slots from *offset* to the end of its bitmap word
+      const uint32_t ready = atomic_u32_load_seq_cst(&ready_bits[offset / 32]) >> (offset % 32);
+      const uint32_t run = count_trailing_zeros_u64(~(uint64_t)ready);
+      end += run;
+      if (run < 32 - (offset % 32)) {
+        break;
+      }
+    }
+
+    if (end == published || atomic_u32_cas(&arr->published, published, end)) {
+      return;
+    }
+    published = atomic_u32_load_acquire(&arr->published);
+  }
+}
+
+void segmented_array_init(segmented_array_t* arr, uint32_t item_size) {
+  memset(arr, 0, sizeof(*arr));
+  arr->item_size = item_size;
+}
+
+void segmented_array_free(segmented_array_t* arr, void* allocator) {
+  for (uint32_t segment = 0; segment < SEGMENTED_ARRAY_SEGMENT_COUNT; ++segment) {
+    if (arr->segments[segment] != NULL) {
+      TABLE_FREE(arr->segments[segment], segmented_array_segment_bytes(arr, segment), arr->segment_classes[segment], allocator);
+    }
+  }
+  segmented_array_init(arr, arr->item_size);
+}
+
+uint32_t segmented_array_count(const segmented_array_t* arr) {
+  return atomic_u32_load_acquire(&arr->published);
+}
+
+uint32_t segmented_array_push(segmented_array_t* arr, const void* item, void* allocator) {
+  return segmented_array_push_n(arr, item, 1, allocator);
+}
+
+uint32_t segmented_array_push_n(segmented_array_t* arr, const void* items, uint32_t count, void* allocator) {
+  const uint32_t first = atomic_u32_fetch_add(&arr->reserved, count);
+  const uint32_t end = first + count;
+
+#ifdef CONTAINERS_CHECK_ENABLED
+  const uint32_t max_count = 0u - (1u << SEGMENTED_ARRAY_FIRST_SEGMENT_BITS);
+  if (end > max_count || end < first) {
+    CONTAINERS_ASSERT_FAILED("first + count <= max_count", "the segmented array is full", __FILE__, __LINE__, __func__);
+  }
+#endif
+
+  // copy the items in a segment at a time, then flag them ready a bitmap word at a time
+  const uint8_t* source = (const uint8_t*)items;
+  for (uint32_t index = first; index < end;) {
+    uint32_t offset;
+    const uint32_t segment = segmented_array_locate(index, &offset);
+    uint8_t* memory = segmented_array_segment(arr, segment, allocator);
+    const uint32_t room = segmented_array_segment_capacity(segment) - offset;
+    const uint32_t run = room < end - index ? room : end - index;
+    memcpy(memory + segmented_array_bitmap_bytes(segment) + ((size_t)offset * arr->item_size), source, (size_t)run * arr->item_size);
+
+    uint32_t* ready_bits = (uint32_t*)memory;
+    for (uint32_t bit = offset; bit < offset + run;) {
+      const uint32_t word_room = 32 - (bit % 32);
+      const uint32_t word_bits = word_room < offset + run - bit ? word_room : offset + run - bit;
+      const uint32_t mask = (word_bits == 32 ? 0xffffffffu : ((1u << word_bits) - 1)) << (bit % 32);
+      atomic_u32_fetch_or(&ready_bits[bit / 32], mask);
+      bit += word_bits;
+    }
+
+    index += run;
+    source += (size_t)run * arr->item_size;
+  }
+
+  segmented_array_publish(arr);
+  return first;
+}
+
+void* segmented_array_at(const segmented_array_t* arr, uint32_t index) {
+#ifdef CONTAINERS_CHECK_ENABLED
+  if (index >= atomic_u32_load_relaxed(&arr->reserved)) {
+    CONTAINERS_ASSERT_FAILED("index < reserved", "the index is past the end of the segmented array", __FILE__, __LINE__, __func__);
   }
+#endif
+
+  uint32_t offset;
+  const uint32_t segment = segmented_array_locate(index, &offset);
+  uint8_t* memory = (uint8_t*)atomic_ptr_load_acquire((void* const*)&arr->segments[segment]);
+  return memory + segmented_array_bitmap_bytes(segment) + ((size_t)offset * arr->item_size);
 }
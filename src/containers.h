@@ -11,6 +11,11 @@ extern "C" {
 #define CONTAINERS_CHECK_ENABLED 1
 #endif
 
+// The assumed size of a cache line. Used to keep data that is written by different threads from sharing a line.
+#ifndef CONTAINERS_CACHE_LINE_SIZE
+#define CONTAINERS_CACHE_LINE_SIZE 64
+#endif
+
 //
 // Array
 //
@@ -119,6 +124,16 @@ typedef struct array_header_t {
     --array__raw_count(arr) \
   )
 
+// Removes every element for which *predicate* returns true, keeping the rest in order. Runs in a single pass.
+#define array_remove_if(arr, predicate, context)      ((arr) ? (array__raw_count(arr) = containers__array_remove_if_impl(arr, array__raw_count(arr), sizeof(*(arr)), predicate, context), 0) : 0)
+
+// Removes every element whose bit is set in *mask* (bit i % 64 of mask[i / 64]), keeping the rest in order. The mask
+// must cover array_count(arr) bits. Runs in a single pass; 4 and 8 byte elements use SIMD compress where available.
+#define array_remove_mask(arr, mask)                  ((arr) ? (array__raw_count(arr) = containers__array_remove_mask_impl(arr, array__raw_count(arr), sizeof(*(arr)), mask), 0) : 0)
+
+// Removes the elements at the given indices, keeping the rest in order. NOTE: the indices must be ascending and unique.
+#define array_remove_indices(arr, indices, n)         ((arr) ? (array__raw_count(arr) = containers__array_remove_indices_impl(arr, array__raw_count(arr), sizeof(*(arr)), indices, n, __FILE__, __LINE__, __func__), 0) : 0)
+
 // clang-format on
 
 // INTERNAL
@@ -126,6 +141,53 @@ void containers__array_free_impl(void* arr, void* allocator, const char* file, i
 void* containers__array_grow_impl(void* arr, uint32_t increment, uint32_t item_size, void* allocator, const char* file, int line, const char* func);
 void containers__array_memcpy(void* dest, const void* src, uint32_t size_bytes);
 void containers__array_check_min_count(void* arr, uint32_t min_count, const char* file, int line, const char* func);
+uint32_t containers__array_remove_if_impl(void* arr, uint32_t count, uint32_t item_size, bool (*predicate)(const void* item, void* context), void* context);
+uint32_t containers__array_remove_mask_impl(void* arr, uint32_t count, uint32_t item_size, const uint64_t* mask);
+uint32_t containers__array_remove_indices_impl(void* arr, uint32_t count, uint32_t item_size, const uint32_t* indices, uint32_t index_count, const char* file, int line, const char* func);
+
+// Sorts the array in ascending order with a stable LSD radix sort (8 bits per pass; passes where every key shares the
+// same digit are skipped). Scratch memory the size of the array is allocated with the library allocator for the
+// duration of the call. Large arrays are split into jobs run through the configured parallel_for function.
+void array_sort_u32(uint32_t* arr, void* allocator);
+void array_sort_u64(uint64_t* arr, void* allocator);
+
+// Sorts the keys array in ascending order and applies the same permutation to *values*, which must hold at least
+// array_count(keys) elements (typically the index each key came from).
+void array_sort_pairs_u32(uint32_t* keys, uint32_t* values, void* allocator);
+void array_sort_pairs_u64(uint64_t* keys, uint32_t* values, void* allocator);
+
+// The index returned by the array search functions when nothing matches.
+#define ARRAY_INDEX_NONE 0xffffffffu
+
+// The array search functions below run SSE2/AVX2/AVX-512 kernels when the cpu supports them. The instruction set is
+// picked once in containers_lib_init (see containers_lib_config_t.simd_level).
+
+// Finds the index of the first element equal to *value*, or ARRAY_INDEX_NONE if there is none.
+uint32_t array_find_first_u32(const uint32_t* arr, uint32_t value);
+uint32_t array_find_first_u64(const uint64_t* arr, uint64_t value);
+uint32_t array_find_first_f32(const float* arr, float value);
+
+// Counts the elements equal to *value*.
+uint32_t array_count_equal_u32(const uint32_t* arr, uint32_t value);
+uint32_t array_count_equal_u64(const uint64_t* arr, uint64_t value);
+uint32_t array_count_equal_f32(const float* arr, float value);
+
+// Tests if any element is equal to *value*.
+bool array_contains_u32(const uint32_t* arr, uint32_t value);
+bool array_contains_u64(const uint64_t* arr, uint64_t value);
+bool array_contains_f32(const float* arr, float value);
+
+// Finds the index of the first smallest element, or ARRAY_INDEX_NONE if the array is empty. NaNs are skipped, so an
+// array of only NaNs also gives ARRAY_INDEX_NONE.
+uint32_t array_min_index_u32(const uint32_t* arr);
+uint32_t array_min_index_u64(const uint64_t* arr);
+uint32_t array_min_index_f32(const float* arr);
+
+// Finds the index of the first largest element, or ARRAY_INDEX_NONE if the array is empty. NaNs are skipped, so an
+// array of only NaNs also gives ARRAY_INDEX_NONE.
+uint32_t array_max_index_u32(const uint32_t* arr);
+uint32_t array_max_index_u64(const uint64_t* arr);
+uint32_t array_max_index_f32(const float* arr);
 
 //
 // Hash
@@ -144,6 +206,16 @@ typedef struct hash_t {
   uint32_t* values;
   uint32_t capacity;
   uint32_t count;
+
+  // optional bloom filter (see hash_filter_enable)
+  uint32_t* filter;
+  uint32_t filter_block_count;
+  uint32_t filter_bits_per_key;
+  uint32_t filter_stale;
+
+  // how the keys/values and the filter were allocated, so they are freed the same way
+  uint8_t keys_class;
+  uint8_t filter_class;
 } hash_t;
 
 // Gets the number of elements currently stored in the hash.
@@ -158,6 +230,15 @@ void hash_free(hash_t* hash, void* allocator);
 // Inserts the given key, value pair into the hashtable, growing more capacity if required.
 void hash_insert(hash_t* hash, uint32_t key, uint32_t value, void* allocator);
 
+// Inserts the key, value pair, or overwrites the value if the key is already in the hashtable. Unlike calling
+// hash_contains and then hash_insert, this walks the probe sequence only once.
+void hash_upsert(hash_t* hash, uint32_t key, uint32_t value, void* allocator);
+
+// Finds the value slot for the key, inserting the key with the given value first if it is missing. *inserted* is set
+// to whether the key was added. The pointer is valid until the next insert, remove or grow, so it suits update loops
+// like `++*hash_find_or_insert(&hash, key, 0, &inserted, NULL)`. The probe sequence is walked only once.
+uint32_t* hash_find_or_insert(hash_t* hash, uint32_t key, uint32_t value, bool* inserted, void* allocator);
+
 // Finds the value stored with the key in the hashtable. If the key is not found the given default value will be returned.
 uint32_t hash_lookup(const hash_t* hash, uint32_t key, uint32_t default_value);
 
@@ -171,30 +252,625 @@ bool hash_contains(const hash_t* hash, uint32_t key);
 // more buckets than requested due to a requirement that the capacity needs to be a power of 2.
 void hash_reserve(hash_t* hash, uint32_t capacity, void* allocator);
 
+// Attaches a cache-line-blocked Bloom filter in front of the table so hash_lookup and hash_contains can reject most
+// absent keys without touching the (possibly huge) key array. It is worth it for large, heavily loaded, miss-heavy
+// tables; in a half-empty table most misses already end at the first probed bucket, so the filter only adds a second
+// cache miss. The filter uses *bits_per_key* bits for every key the table can hold before growing (0 picks 10, for
+// roughly a 2% false positive rate); it is updated on insert and rebuilt on grow. Removed keys stay in the filter until
+// enough have accumulated to trigger an automatic rebuild. hash_free also frees the filter.
+void hash_filter_enable(hash_t* hash, uint32_t bits_per_key, void* allocator);
+
+// Frees the filter; lookups go straight to the table again.
+void hash_filter_disable(hash_t* hash, void* allocator);
+
+// Rebuilds the filter from the keys currently in the table, clearing out keys that have been removed.
+void hash_filter_rebuild(hash_t* hash);
+
+// Iterates over the occupied buckets. Empty buckets are skipped with SIMD compares, many buckets at a time.
+//
+//   hash_iter_t iter;
+//   hash_iter_init(&hash, &iter, 0, 1);
+//   while (hash_iter_next(&hash, &iter)) {
+//     use(iter.key, iter.value);
+//   }
+//
+// The buckets can be split into *chunk_count* chunks that are iterated independently (e.g. one per thread); each key
+// is in exactly one chunk. When iterating the whole table as one chunk, the current key may be removed with
+// hash_iter_remove (not hash_remove) and every other key is still visited exactly once. Inserting during iteration is
+// not supported.
+typedef struct hash_iter_t {
+  uint32_t key;
+  uint32_t value;
+  uint32_t index; // the bucket holding the current key
+
+  // INTERNAL
+  uint32_t origin;
+  uint32_t position;
+  uint32_t end;
+} hash_iter_t;
+
+// Starts iterating over chunk *chunk_index* of *chunk_count*. Use 0 and 1 to iterate over the whole table.
+void hash_iter_init(const hash_t* hash, hash_iter_t* iter, uint32_t chunk_index, uint32_t chunk_count);
+
+// Advances to the next occupied bucket in the chunk. Returns false when the chunk is exhausted.
+bool hash_iter_next(const hash_t* hash, hash_iter_t* iter);
+
+// Removes the current key, leaving the iterator ready for the next hash_iter_next.
+void hash_iter_remove(hash_t* hash, hash_iter_t* iter);
+
+//
+// Hash set
+//
+// A keys-only variant of hash_t for membership tests and dedup. It uses the same robin hood layout and load factor but
+// allocates no value array, so it takes half the memory and half the copying when it grows. As with hash_t, the key 0
+// is reserved to mark empty buckets.
+//
+
+typedef struct hash_set_t {
+  uint32_t* keys;
+  uint32_t capacity;
+  uint32_t count;
+  uint8_t keys_class; // how the keys were allocated, so they are freed the same way
+} hash_set_t;
+
+// Gets the number of keys currently stored in the set.
+uint32_t hash_set_count(const hash_set_t* set);
+
+// Gets the capacity (in this case number of buckets) available to the set.
+uint32_t hash_set_capacity(const hash_set_t* set);
+
+// Frees the set and effectively empties it.
+void hash_set_free(hash_set_t* set, void* allocator);
+
+// Adds the key to the set, growing more capacity if required. Returns false if the key was already present.
+bool hash_set_insert(hash_set_t* set, uint32_t key, void* allocator);
+
+// Tests if the set contains the given key.
+bool hash_set_contains(const hash_set_t* set, uint32_t key);
+
+// Removes the key from the set. Returns false if the key was not present.
+bool hash_set_remove(hash_set_t* set, uint32_t key);
+
+// Ensures the set can hold at least the given number of keys. The bucket count is rounded up to a power of 2.
+void hash_set_reserve(hash_set_t* set, uint32_t capacity, void* allocator);
+
+//
+// Small hash
+//
+// A compact variant of hash_t for programs that keep many small tables (at most HASH_SMALL_MAX_COUNT entries each).
+// Value indices are 16 bits, the table starts at 8 buckets instead of 128, and the keys and values share one cache line
+// aligned allocation, so an empty table costs nothing and a table of a dozen entries fits in a cache line or two.
+// Tables of up to 32 buckets are searched whole with SIMD compares instead of probing.
+//
+// A table made with hash_small_init(&hash, true) goes further and stores a 16-bit fingerprint of each key instead of
+// the key, halving the bucket size again. The fingerprint is the low 16 bits of the key, which also pick the bucket, so
+// lookups can report false positives: hash_small_find_next walks every entry whose fingerprint matches, and the caller
+// checks the candidate values against its own copy of the keys. The larger the table, the fewer fingerprint bits are
+// left over to tell keys in the same probe run apart, so fingerprints suit the smallest tables best.
+//
+// As with hash_t, the keys are expected to be well mixed hashes and the key 0 is reserved.
+//
+//   uint32_t cursor = 0;
+//   for (uint32_t value = hash_small_find_next(&hash, key, &cursor); value != HASH_SMALL_NONE; value = hash_small_find_next(&hash, key, &cursor)) {
+//     if (items[value].key == key) {
+//       ...
+//     }
+//   }
+//
+
+#define HASH_SMALL_NONE 0xffffffffu
+#define HASH_SMALL_MAX_COUNT 58982
+
+typedef struct hash_small_t {
+  // 32-bit keys or 16-bit fingerprints, followed by the 16-bit values in the same allocation
+  void* keys;
+  uint32_t capacity;
+  uint16_t count;
+  bool fingerprints;
+  uint8_t keys_class; // how the keys were allocated, so they are freed the same way
+} hash_small_t;
+
+// Sets up an empty table. A zero-initialized hash_small_t is the same as one made with *fingerprints* false.
+void hash_small_init(hash_small_t* hash, bool fingerprints);
+
+// Frees the table and effectively empties it. The fingerprint setting is kept.
+void hash_small_free(hash_small_t* hash, void* allocator);
+
+// Gets the number of entries in the table.
+uint32_t hash_small_count(const hash_small_t* hash);
+
+// Gets the number of buckets in the table.
+uint32_t hash_small_capacity(const hash_small_t* hash);
+
+// Gets the bytes allocated for the table.
+size_t hash_small_size_bytes(const hash_small_t* hash);
+
+// Inserts the key, value pair, growing the table if required. The key must not already be in the table.
+void hash_small_insert(hash_small_t* hash, uint32_t key, uint16_t value, void* allocator);
+
+// Finds the value stored with the key, or *default_value* if it is missing. With fingerprints this is just one of the
+// candidates; use hash_small_find_next when keys can share a fingerprint.
+uint32_t hash_small_lookup(const hash_small_t* hash, uint32_t key, uint32_t default_value);
+
+// Finds the next value stored with the key (or a key with the same fingerprint), or HASH_SMALL_NONE when there are no
+// more. Start with *cursor* at 0.
+uint32_t hash_small_find_next(const hash_small_t* hash, uint32_t key, uint32_t* cursor);
+
+// Tests if the table contains the key. With fingerprints a true result may be a false positive.
+bool hash_small_contains(const hash_small_t* hash, uint32_t key);
+
+// Removes the entry with the key and value. Returns false if there is none. Passing the value tells apart keys that
+// share a fingerprint.
+bool hash_small_remove(hash_small_t* hash, uint32_t key, uint16_t value);
+
+// Ensures the table can hold at least the given number of entries. The bucket count is rounded up to a power of 2.
+void hash_small_reserve(hash_small_t* hash, uint32_t capacity, void* allocator);
+
+//
+// Frozen hash
+//
+// An immutable copy of a hash_t for tables that stop changing after load. It is a bucketized cuckoo table: every
+// bucket is one 64-byte aligned cache line holding 8 keys followed by their 8 values, and each key lives in one of two
+// candidate buckets. A lookup therefore touches at most two cache lines, and only one when the key sits in its first
+// bucket (most hits do). The bucket count is not rounded to a power of 2 and buckets are filled to about 96%, so it
+// needs noticeably less memory than a hash_t, which averages around 70% occupancy between growths.
+//
+// Building is a one-off cost (a cuckoo insertion per key, retried with more buckets in the rare case it gets stuck).
+// As with hash_t, the key 0 is reserved to mark empty slots.
+//
+
+typedef struct hash_frozen_t {
+  uint32_t* buckets; // cache line aligned, bucket_count * 16 words
+  uint32_t bucket_count;
+  uint32_t count;
+  uint32_t seed;
+  uint8_t buckets_class; // how the buckets were allocated, so they are freed the same way
+} hash_frozen_t;
+
+// Builds a frozen copy of the hash's current contents. The hash itself is left untouched.
+void hash_freeze(const hash_t* hash, hash_frozen_t* frozen, void* allocator);
+
+// Frees the frozen hash and effectively empties it.
+void hash_frozen_free(hash_frozen_t* frozen, void* allocator);
+
+// Gets the number of elements stored in the frozen hash.
+uint32_t hash_frozen_count(const hash_frozen_t* frozen);
+
+// Gets the number of bytes used by the buckets.
+size_t hash_frozen_size_bytes(const hash_frozen_t* frozen);
+
+// Finds the value stored with the key. If the key is not found the given default value will be returned.
+uint32_t hash_frozen_lookup(const hash_frozen_t* frozen, uint32_t key, uint32_t default_value);
+
+// Tests if the frozen hash contains the given key.
+bool hash_frozen_contains(const hash_frozen_t* frozen, uint32_t key);
+
+//
+// Join
+//
+// An equi-join of two uint32 key arrays, for when building a hash_t from one array and calling hash_lookup for every
+// element of the other spends its time in cache misses. Both arrays are first radix partitioned on the top bits of a
+// hash of the key so that each build partition's table fits in the L2 cache, then every partition builds a chained
+// table from its build keys and probes it with its probe keys. Partitioning and the per-partition work are split into
+// jobs run through the configured parallel_for function.
+//
+// Every key value is allowed (0 included) and duplicate keys on either side produce every matching pair. The matches
+// are counted before they are written, so the output arrays grow once, on the calling thread, and the output is the
+// same whatever the job count. Pairs come out grouped by partition rather than in input order.
+//
+// Scratch memory of 8 bytes per key on each side, plus one partition-sized table per job, is allocated with the library
+// allocator for the duration of the call.
+//
+
+// Appends a (build index, probe index) pair to *build_indices* and *probe_indices* for every build_keys[build index] ==
+// probe_keys[probe index], and returns the number of pairs appended. The keys are arrays; the outputs are pointers to
+// arrays (which may be NULL) that grow as needed.
+uint32_t hash_join_u32(const uint32_t* build_keys, const uint32_t* probe_keys, uint32_t** build_indices, uint32_t** probe_indices, void* allocator);
+
+//
+// Sorted index
+//
+// A static search tree over a sorted array of uint32 keys for lower bound, upper bound and range queries. Binary search
+// over a large array takes a cache miss on nearly every step; this index lays the keys out as an implicit B+ tree
+// (https://en.algorithmica.org/hpc/data-structures/s-tree/) whose nodes are single cache lines of 16 keys with 17
+// children, so a query over a billion keys touches 8 lines instead of 30. Each node is searched with SSE2/AVX2/AVX-512
+// compares picked at containers_lib_init.
+//
+// The leaf layer is a copy of the sorted keys, so the ranks returned by the queries index straight into
+// sorted_index_keys (and into the source array), and range scans walk contiguous memory. The index takes about 1/16th
+// more memory than the keys themselves and is rebuilt from scratch if the keys change.
+//
+
+// The most layers an index can have (the leaves plus enough levels of 17 way nodes to cover 2^32 keys).
+#define SORTED_INDEX_MAX_LAYERS 8
+
+typedef struct sorted_index_t {
+  uint32_t* keys; // cache line aligned; the leaf layer followed by the node layers
+  uint32_t count;
+  uint32_t layer_count;
+  uint32_t layer_offsets[SORTED_INDEX_MAX_LAYERS]; // the word offset of each layer, leaves first
+  uint8_t keys_class; // how the keys were allocated, so they are freed the same way
+} sorted_index_t;
+
+// Builds the index over the keys of the array, which must be sorted in ascending order. Duplicates are allowed.
+void sorted_index_init(sorted_index_t* index, const uint32_t* sorted_arr, void* allocator);
+
+// Frees the index and effectively empties it.
+void sorted_index_free(sorted_index_t* index, void* allocator);
+
+// Gets the number of keys in the index.
+uint32_t sorted_index_count(const sorted_index_t* index);
+
+// Gets the sorted keys (sorted_index_count of them) that the ranks returned below index into.
+const uint32_t* sorted_index_keys(const sorted_index_t* index);
+
+// Finds the rank of the first key that is not less than *value*, or the key count if there is none.
+uint32_t sorted_index_lower_bound(const sorted_index_t* index, uint32_t value);
+
+// Finds the rank of the first key that is greater than *value*, or the key count if there is none.
+uint32_t sorted_index_upper_bound(const sorted_index_t* index, uint32_t value);
+
+// Counts the keys in [min, max] and sets *begin* to the rank of the first of them, so a range scan is
+//
+//   uint32_t begin;
+//   const uint32_t count = sorted_index_range(&index, min, max, &begin);
+//   for (uint32_t rank = begin; rank < begin + count; ++rank) {
+//     use(sorted_index_keys(&index)[rank]);
+//   }
+uint32_t sorted_index_range(const sorted_index_t* index, uint32_t min, uint32_t max, uint32_t* begin);
+
+//
+// Slot map
+//
+// Stores items by value behind stable 64-bit handles, for objects that come and go while other code holds on to them.
+// The items are packed densely (removing one moves the last item into its place) so iterating them is a linear walk,
+// while a sparse slot array maps each handle to wherever its item currently lives. Freed slots are kept on a free list
+// and reused.
+//
+// A handle is the slot index in the low 32 bits and the slot's generation in the high 32 bits. The generation is odd
+// while the slot is in use and is bumped on every insert and remove, so handles to removed items are rejected instead
+// of aliasing whatever reuses the slot. SLOT_MAP_HANDLE_NONE (0) is never a valid handle.
+//
+//   slot_map_t map;
+//   slot_map_init(&map, sizeof(particle_t));
+//   const slot_map_handle_t handle = slot_map_insert(&map, &particle, NULL);
+//   particle_t* found = (particle_t*)slot_map_get(&map, handle);
+//   slot_map_remove(&map, handle);
+//
+
+typedef uint64_t slot_map_handle_t;
+
+#define SLOT_MAP_HANDLE_NONE 0
+
+typedef struct slot_map_t {
+  // dense, slot_map_count items of item_size bytes (a stretchy array) and the slot that owns each one
+  uint8_t* values;
+  uint32_t* value_slots;
+
+  // sparse, indexed by handle: the dense index of the item (or the next free slot) and the generation
+  uint32_t* slots;
+  uint32_t* generations;
+  uint32_t free_head;
+  uint32_t item_size;
+} slot_map_t;
+
+// Sets up an empty slot map of items of *item_size* bytes each. No memory is allocated until the first insert.
+void slot_map_init(slot_map_t* map, uint32_t item_size);
+
+// Frees the slot map and effectively empties it. Every handle becomes invalid.
+void slot_map_free(slot_map_t* map, void* allocator);
+
+// Gets the number of items in the slot map.
+uint32_t slot_map_count(const slot_map_t* map);
+
+// Ensures the slot map can hold at least *capacity* items without allocating.
+void slot_map_reserve(slot_map_t* map, uint32_t capacity, void* allocator);
+
+// Copies an item into the slot map and returns its handle.
+slot_map_handle_t slot_map_insert(slot_map_t* map, const void* item, void* allocator);
+
+// Removes the item for the handle. Returns false if the handle is stale or was never issued.
+bool slot_map_remove(slot_map_t* map, slot_map_handle_t handle);
+
+// Tests if the handle refers to an item in the slot map.
+bool slot_map_contains(const slot_map_t* map, slot_map_handle_t handle);
+
+// Gets a pointer to the item for the handle, or NULL if the handle is stale. The pointer is valid until the next
+// insert or remove, which may move items.
+void* slot_map_get(const slot_map_t* map, slot_map_handle_t handle);
+
+// Gets the packed items (slot_map_count of them) for iteration. Valid until the next insert or remove.
+void* slot_map_values(const slot_map_t* map);
+
+// Gets the handle of the item at *index* in slot_map_values.
+slot_map_handle_t slot_map_handle_at(const slot_map_t* map, uint32_t index);
+
+//
+// Queue
+//
+// Bounded lock-free ring queues for handing items between threads. The storage is allocated once at init time with the
+// library allocator and never grows, so a push to a full queue (or a pop from an empty one) simply fails. Items are
+// copied in and out by value; the item size is fixed at init time. The capacity is rounded up to a power of 2.
+//
+// The head and tail indices are separated by a full cache line so the producer and consumer sides do not contend for
+// the same line.
+//
+// spsc_queue_t supports exactly one producer thread and one consumer thread. mpmc_queue_t supports any number of each
+// and is based on Dmitry Vyukov's bounded MPMC queue (a sequence number per cell).
+//
+// The _n variants transfer up to N items with a single index update and return the number actually transferred.
+//
+
+typedef struct spsc_queue_t {
+  uint8_t* items;
+  uint32_t capacity;
+  uint32_t item_size;
+  uint8_t pad0[CONTAINERS_CACHE_LINE_SIZE];
+
+  // written by the consumer
+  uint32_t head;
+  uint32_t tail_cached;
+  uint8_t pad1[CONTAINERS_CACHE_LINE_SIZE];
+
+  // written by the producer
+  uint32_t tail;
+  uint32_t head_cached;
+  uint8_t pad2[CONTAINERS_CACHE_LINE_SIZE];
+} spsc_queue_t;
+
+typedef struct mpmc_queue_t {
+  uint32_t* sequences;
+  uint8_t* items;
+  uint32_t capacity;
+  uint32_t item_size;
+  uint8_t pad0[CONTAINERS_CACHE_LINE_SIZE];
+
+  // written by the consumers
+  uint32_t head;
+  uint8_t pad1[CONTAINERS_CACHE_LINE_SIZE];
+
+  // written by the producers
+  uint32_t tail;
+  uint8_t pad2[CONTAINERS_CACHE_LINE_SIZE];
+} mpmc_queue_t;
+
+// Allocates storage for at least *capacity* items of *item_size* bytes each. Not thread safe.
+void spsc_queue_init(spsc_queue_t* queue, uint32_t capacity, uint32_t item_size, void* allocator);
+
+// Frees the queue storage. Not thread safe.
+void spsc_queue_free(spsc_queue_t* queue, void* allocator);
+
+// Gets the number of items in the queue. This is only a snapshot when other threads are active.
+uint32_t spsc_queue_count(const spsc_queue_t* queue);
+
+// Copies an item onto the queue. Returns false if the queue is full. Producer thread only.
+bool spsc_queue_push(spsc_queue_t* queue, const void* item);
+
+// Copies up to *count* items onto the queue. Returns the number pushed. Producer thread only.
+uint32_t spsc_queue_push_n(spsc_queue_t* queue, const void* items, uint32_t count);
+
+// Copies an item off the queue. Returns false if the queue is empty. Consumer thread only.
+bool spsc_queue_pop(spsc_queue_t* queue, void* item);
+
+// Copies up to *count* items off the queue. Returns the number popped. Consumer thread only.
+uint32_t spsc_queue_pop_n(spsc_queue_t* queue, void* items, uint32_t count);
+
+// Allocates storage for at least *capacity* items of *item_size* bytes each. Not thread safe.
+void mpmc_queue_init(mpmc_queue_t* queue, uint32_t capacity, uint32_t item_size, void* allocator);
+
+// Frees the queue storage. Not thread safe.
+void mpmc_queue_free(mpmc_queue_t* queue, void* allocator);
+
+// Gets the number of items in the queue. This is only a snapshot when other threads are active.
+uint32_t mpmc_queue_count(const mpmc_queue_t* queue);
+
+// Copies an item onto the queue. Returns false if the queue is full.
+bool mpmc_queue_push(mpmc_queue_t* queue, const void* item);
+
+// Copies up to *count* items onto the queue as one contiguous run. Returns the number pushed.
+uint32_t mpmc_queue_push_n(mpmc_queue_t* queue, const void* items, uint32_t count);
+
+// Copies an item off the queue. Returns false if the queue is empty.
+bool mpmc_queue_pop(mpmc_queue_t* queue, void* item);
+
+// Copies up to *count* items off the queue as one contiguous run. Returns the number popped.
+uint32_t mpmc_queue_pop_n(mpmc_queue_t* queue, void* items, uint32_t count);
+
+//
+// Segmented array
+//
+// An append-only array that any number of threads can push to at once without locks. Items live in a fixed table of
+// segments where segment k holds 1024 << k items, so the array never reallocates: a pointer returned by
+// segmented_array_at stays valid until segmented_array_free, and readers can walk the array while writers are still
+// appending. Segments are allocated with the library allocator the first time a push reaches them.
+//
+// A push reserves its slots with a single atomic add and copies the items in, then marks them ready. The count only
+// advances over a contiguous run of ready slots, so every index below segmented_array_count has been fully written even
+// though pushes can finish out of order.
+//
+// The reservation and published counters sit on their own cache lines so readers polling the count do not contend with
+// writers reserving slots.
+//
+
+#define SEGMENTED_ARRAY_SEGMENT_COUNT 22
+
+typedef struct segmented_array_t {
+  // each segment is a bitmap of ready slots followed by the items
+  uint8_t* segments[SEGMENTED_ARRAY_SEGMENT_COUNT];
+  uint8_t segment_classes[SEGMENTED_ARRAY_SEGMENT_COUNT]; // how each segment was allocated, set by its installer
+  uint32_t item_size;
+  uint8_t pad0[CONTAINERS_CACHE_LINE_SIZE];
+
+  // the next slot to hand out
+  uint32_t reserved;
+  uint8_t pad1[CONTAINERS_CACHE_LINE_SIZE];
+
+  // every slot below this has been written
+  uint32_t published;
+  uint8_t pad2[CONTAINERS_CACHE_LINE_SIZE];
+} segmented_array_t;
+
+// Sets up an empty array of items of *item_size* bytes each. No memory is allocated until the first push.
+void segmented_array_init(segmented_array_t* arr, uint32_t item_size);
+
+// Frees every segment and effectively empties the array. Not thread safe.
+void segmented_array_free(segmented_array_t* arr, void* allocator);
+
+// Gets the number of items that are safe to read. This is only a snapshot when other threads are pushing.
+uint32_t segmented_array_count(const segmented_array_t* arr);
+
+// Copies an item onto the end of the array and returns its index.
+uint32_t segmented_array_push(segmented_array_t* arr, const void* item, void* allocator);
+
+// Copies *count* items onto the end of the array as one contiguous run and returns the index of the first.
+uint32_t segmented_array_push_n(segmented_array_t* arr, const void* items, uint32_t count, void* allocator);
+
+// Gets a pointer to the item at *index*, which must be below segmented_array_count or have been returned by a push that
+// has completed on this thread. The pointer stays valid until the array is freed.
+void* segmented_array_at(const segmented_array_t* arr, uint32_t index);
+
+//
+// Profiling
+//
+// Libraries built with CONTAINERS_PROFILE_ENABLED defined (cmake -DCONTAINERS_PROFILE=ON) count hardware events around
+// hash_insert, hash_lookup, hash_remove, hash growth and array growth using Linux perf_event_open, so a slow table can
+// be put down to cache misses, TLB misses or mispredicted branches rather than guessed at. Counters are read from user
+// space with rdpmc where the kernel allows it (otherwise with a read syscall per sample, which is far slower). Counts
+// are inclusive: a hash_insert that grows the table also includes the grow. The fixed cost of reading the counters is
+// included too, so compare averages against each other rather than against zero.
+//
+// Only operations on the thread that called containers_profile_start are counted. In other builds, and on other
+// platforms, the functions below are still available but nothing is collected.
+//
+
+typedef enum containers_profile_op_t {
+  CONTAINERS_PROFILE_HASH_INSERT,
+  CONTAINERS_PROFILE_HASH_LOOKUP,
+  CONTAINERS_PROFILE_HASH_REMOVE,
+  CONTAINERS_PROFILE_HASH_GROW,
+  CONTAINERS_PROFILE_ARRAY_GROW,
+  CONTAINERS_PROFILE_OP_COUNT,
+} containers_profile_op_t;
+
+typedef enum containers_profile_counter_t {
+  CONTAINERS_PROFILE_CYCLES,
+  CONTAINERS_PROFILE_INSTRUCTIONS,
+  CONTAINERS_PROFILE_L1D_MISSES,
+  CONTAINERS_PROFILE_LLC_MISSES,
+  CONTAINERS_PROFILE_BRANCH_MISSES,
+  CONTAINERS_PROFILE_DTLB_MISSES,
+  CONTAINERS_PROFILE_COUNTER_COUNT,
+} containers_profile_counter_t;
+
+// The totals for one operation since profiling was started or reset.
+typedef struct containers_profile_stats_t {
+  uint64_t calls;
+  uint64_t counters[CONTAINERS_PROFILE_COUNTER_COUNT];
+} containers_profile_stats_t;
+
+// Opens the counters and starts profiling operations on the calling thread. Returns false if no hardware counter could
+// be opened (a build without profiling, not Linux, no PMU exposed as in many VMs, or a strict perf_event_paranoid);
+// profiling builds still count calls then.
+bool containers_profile_start();
+
+// Stops profiling and closes the counters. The totals are kept until the next reset or start.
+void containers_profile_stop();
+
+// Clears the totals.
+void containers_profile_reset();
+
+// Tests if the given counter was opened by containers_profile_start. Counters that were not opened read as 0.
+bool containers_profile_counter_available(containers_profile_counter_t counter);
+
+// Gets the totals for the given operation. Divide by calls for per-operation averages.
+void containers_profile_read(containers_profile_op_t op, containers_profile_stats_t* stats);
+
+// Gets printable names for reports.
+const char* containers_profile_op_name(containers_profile_op_t op);
+const char* containers_profile_counter_name(containers_profile_counter_t counter);
+
 //
 // Library initialization and configuration
 //
+// The allocator and assert handler are normally the function pointers in containers_lib_config_t. A build can bind
+// them at compile time instead, so the calls can be inlined, by compiling the library with CONTAINERS_USER_CONFIG set
+// to a header (cmake -DCONTAINERS_USER_CONFIG=path/to/header.h) that defines CONTAINERS_ALLOC, CONTAINERS_FREE and/or
+// CONTAINERS_ASSERT_FAILED as macros with the same parameters as the config functions, e.g.
+//
+//   #include <mimalloc.h>
+//   #define CONTAINERS_ALLOC(size, allocator, file, line, func) mi_malloc(size)
+//   #define CONTAINERS_FREE(ptr, allocator, file, line, func) mi_free(ptr)
+//
+
+// The instruction sets the SIMD kernels can use, in increasing order.
+typedef enum containers_simd_t {
+  CONTAINERS_SIMD_SCALAR,
+  CONTAINERS_SIMD_SSE2,
+  CONTAINERS_SIMD_AVX2,
+  CONTAINERS_SIMD_AVX512,
+  CONTAINERS_SIMD_BEST,
+} containers_simd_t;
+
+// The size hint passed to the aligned allocation functions.
+typedef enum containers_size_class_t {
+  CONTAINERS_SIZE_CLASS_SMALL,
+  CONTAINERS_SIZE_CLASS_LARGE, // at least large_alloc_threshold bytes
+} containers_size_class_t;
 
 typedef struct containers_lib_config_t {
-  // The function used to allocate memory. The default implementation is malloc().
+  // The function used to allocate memory. The default implementation is malloc(). Ignored when the library is built
+  // with CONTAINERS_ALLOC (see CONTAINERS_USER_CONFIG below).
   void* (*alloc)(size_t size, void* allocator, const char* file, int line, const char* func);
 
-  // The function used to free memory. The default implementation is free().
+  // The function used to free memory. The default implementation is free(). Ignored when the library is built with
+  // CONTAINERS_FREE.
   void (*free)(void* ptr, void* allocator, const char* file, int line, const char* func);
 
-  // The function used when an assertion fails.
+  // The functions used for the flat arrays behind hash_t, hash_set_t, hash_frozen_t and sorted_index_t, which are
+  // allocated aligned to a cache line so buckets and nodes never straddle two lines. *size_class* says whether the size
+  // reaches large_alloc_threshold, and free_aligned is given the same size and class back (the containers record the
+  // class with each block, so a later containers_lib_init does not change how existing blocks are freed). The default
+  // implementation carves the memory out of alloc when alloc/free have been replaced, so a custom allocator still sees
+  // every allocation. Otherwise it uses aligned malloc for small sizes, and on Linux maps large sizes directly, backed
+  // by transparent huge pages (madvise MADV_HUGEPAGE) so random probes into a big table stop missing the dTLB.
+  void* (*alloc_aligned)(size_t size, size_t alignment, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func);
+  void (*free_aligned)(void* ptr, size_t size, containers_size_class_t size_class, void* allocator, const char* file, int line, const char* func);
+
+  // The size in bytes from which aligned allocations are CONTAINERS_SIZE_CLASS_LARGE. The default is 2MB, one huge page.
+  size_t large_alloc_threshold;
+
+  // The NUMA node the default large allocations are bound to (Linux, nodes 0-63), or -1 to leave placement to the os.
+  // The default is -1.
+  int32_t numa_node;
+
+  // The function used when an assertion fails. Ignored when the library is built with CONTAINERS_ASSERT_FAILED.
   void (*assert_failed)(const char* expression, const char* message, const char* file, int line, const char* func);
+
+  // The function used to run *job_count* independent jobs which may execute in parallel. It must not return until
+  // every job has finished. The default implementation runs the jobs in order on the calling thread.
+  void (*parallel_for)(void (*job)(void* context, uint32_t job_index), void* context, uint32_t job_count);
+
+  // The maximum number of jobs large operations are split into for parallel_for. The default is 1.
+  uint32_t job_count;
+
+  // The highest instruction set the SIMD kernels may use. It is capped to what the cpu supports at init time. The
+  // default is CONTAINERS_SIMD_BEST.
+  containers_simd_t simd_level;
 } containers_lib_config_t;
 
 // Initializes the given config struct to fill it in with the default values.
 void containers_lib_config_init(containers_lib_config_t* config);
 
-// Initializes this library.
+// Initializes this library. A non-NULL *config* must start from containers_lib_config_init, so fields it does not set
+// keep their defaults.
 void containers_lib_init(const containers_lib_config_t* config);
 
 // Tears down this library.
 void containers_lib_shutdown();
 
+// Gets the instruction set the SIMD kernels are using.
+containers_simd_t containers_lib_simd_level();
+
 #ifdef __cplusplus
 }
 #endif